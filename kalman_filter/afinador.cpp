@@ -0,0 +1,264 @@
+// ============================================================
+//  AFINADOR DE PARÁMETROS PARA filtrokalman5.cpp
+//  Herramienta de PC (no es un sketch): repite capturas DEBUG a través del
+//  mismo filtro y la misma lógica de activación del sketch, que se incluye
+//  compilado con KALMAN_REPLAY, y recorre en rejilla kalman_q0_x100,
+//  kalman_r0_x10, STABLE_THRESHOLD_Q8, UNCERT_THRESHOLD_X10 y HISTORY_SIZE
+//  con todos los núcleos (un proceso hijo por combinación y captura, que
+//  parte del estado inicial del sketch sin reiniciar nada a mano).
+//  Resultado: la combinación con menor latencia de activación cuyas
+//  activaciones falsas no superan el límite, lista para copiar al sketch.
+//
+//  Referencia de cada captura: la distancia suavizada de suavizador_rts.cpp.
+//  Compilar con los mismos #define que el sketch (KALMAN_CV, KALMAN_X10, ...):
+//            g++ -std=gnu++11 -O2 -o afinador afinador.cpp
+//  Uso:      ./suavizador_rts captura.log > suave.csv
+//            ./afinador [-f falsas] [-j procesos] captura.log suave.csv [...]
+// ============================================================
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "registro_debug.h"
+
+// — Núcleo Arduino mínimo para compilar el sketch en el PC —
+#define HIGH 1
+#define LOW 0
+#define OUTPUT 1
+#define A0 14
+#define F(s) (s)
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+struct NullSerial {
+  void begin(long) {}
+  template <typename T> void print(T) {}
+  template <typename T> void println(T) {}
+  void println() {}
+} Serial;
+
+// — Sketch sin hardware, con los parámetros de ajuste como variables —
+#define KALMAN_REPLAY
+#define HISTORY_CAPACITY 8
+uint8_t historySize = 5;
+#define HISTORY_SIZE historySize
+#include "filtrokalman5.cpp"
+
+// — Rejilla de búsqueda —
+const uint8_t GRID_Q0_X100[] = {1, 2, 5, 10, 20};
+const uint8_t GRID_R0_X10[] = {2, 5, 10, 20};
+const uint16_t GRID_STABLE_Q8[] = {26, 51, 77, 102, 154};  // 0.1-0.6 cm
+const uint8_t GRID_UNCERT_X10[] = {2, 3, 4, 6, 10};
+const uint8_t GRID_HISTORY[] = {3, 4, 5, 6, 8};
+
+#define TRUTH_MARGIN 1.0f  // cm de tolerancia de la referencia suavizada
+
+struct Params {
+  uint8_t q0_x100, r0_x10;
+  uint16_t stable_q8;
+  uint8_t uncert_x10, history;
+};
+
+// Captura: lecturas por ciclo (NUM_SENSORS cada una) y distancia de referencia
+struct Trace {
+  const char *name;
+  std::vector<float> z;
+  std::vector<float> truth;
+};
+
+// Resultado de una combinación sobre una captura (enviado por la tubería)
+struct Result {
+  uint32_t job;
+  uint16_t episodes;   // entradas a la zona de activación con el LED listo
+  uint16_t misses;     // episodios sin activación
+  uint16_t falses;     // activaciones fuera de la zona
+  uint32_t latencyMs;  // suma de latencias de los episodios activados
+};
+
+struct Score {
+  uint32_t episodes, misses, falses;
+  uint64_t latencyMs;
+};
+
+// — Carga de una captura y de su referencia —
+static bool load_trace(const char *logPath, const char *csvPath, Trace &t) {
+  MappedFile log, csv;
+  if (!log.open(logPath)) { perror(logPath); return false; }
+  if (!csv.open(csvPath)) { perror(csvPath); return false; }
+  t.name = logPath;
+  log.for_each_line([&](const char *line, const char *eol) {
+    DebugCycle c;
+    if (!debug_parse_cycle(line, eol, c)) return;
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) t.z.push_back(i < DEBUG_MAX_SENSORS ? c.z[i] : 0);
+  });
+  // CSV: ciclo,x_cm,...; la cabecera no empieza por dígito
+  csv.for_each_line([&](const char *line, const char *eol) {
+    const char *p = (const char *)memchr(line, ',', eol - line);
+    float x;
+    if (p && line[0] >= '0' && line[0] <= '9' && debug_parse_number(++p, eol, x)) t.truth.push_back(x);
+  });
+  if (t.truth.size() * NUM_SENSORS != t.z.size()) {
+    fprintf(stderr, "%s: %zu ciclos y %zu filas de referencia\n", logPath, t.z.size() / NUM_SENSORS, t.truth.size());
+    return false;
+  }
+  return true;
+}
+
+// cm registrados por print_q8 (centésimas truncadas) a Q8.8: el centro
+// del intervalo de valores que se imprimen igual
+static uint16_t logged_q8(float cm) {
+  if (cm <= 0) return 0;  // sin eco
+  uint32_t hundredths = (uint32_t)(cm * 100 + 0.5f);
+  return ((hundredths / 100) << 8) + ((2 * (hundredths % 100) + 1) * 128) / 100;
+}
+
+// — Repetición de una captura con el sketch (en un proceso hijo) —
+static Result replay(const Params &k, const Trace &t) {
+  kalman_q0_x100 = k.q0_x100;
+  kalman_r0_x10 = k.r0_x10;
+  STABLE_THRESHOLD_Q8 = k.stable_q8;
+  UNCERT_THRESHOLD_X10 = k.uncert_x10;
+  historySize = k.history;
+  kalman_init();
+
+  Result r = {};
+  bool episode = false;
+  unsigned long episodeStart = 0;
+  for (size_t c = 0; c < t.truth.size(); c++) {
+    unsigned long now = c * READ_INTERVAL;
+    update_led_cycle(now);  // entre ciclos el LED avanza con loop()
+    uint16_t z[NUM_SENSORS];
+    for (uint8_t i = 0; i < NUM_SENSORS; i++)
+      z[i] = sensors.fired(i) ? logged_q8(t.z[c * NUM_SENSORS + i]) : 0;
+    uint8_t before = currentLedState;
+    process_cycle(z, now);
+    bool activated = (before == LED_OFF && currentLedState == LED_ON);
+
+    float x = t.truth[c];
+    bool inside = (x >= ACTIVATION_MIN && x <= SAFE_MAX_DIST);
+    bool outside = (x < ACTIVATION_MIN - TRUTH_MARGIN || x > SAFE_MAX_DIST + TRUTH_MARGIN);
+    if (!inside && episode) {
+      r.misses++;
+      episode = false;
+    }
+    if (inside && !episode && before == LED_OFF) {
+      episode = true;
+      episodeStart = now;
+      r.episodes++;
+    }
+    if (activated) {
+      if (outside) r.falses++;
+      if (episode) r.latencyMs += now - episodeStart;
+      episode = false;
+    }
+  }
+  if (episode) r.misses++;
+  return r;
+}
+
+// Menos fallos primero; a igualdad, menor latencia media
+static bool better(const Score &a, const Score &b) {
+  if (a.misses != b.misses) return a.misses < b.misses;
+  uint32_t hitsA = a.episodes - a.misses, hitsB = b.episodes - b.misses;
+  return a.latencyMs * hitsB < b.latencyMs * hitsA;
+}
+
+static void print_score(const char *label, const Params &k, const Score &s) {
+  uint32_t hits = s.episodes - s.misses;
+  printf("%-9s q0_x100=%-2u r0_x10=%-2u stable_q8=%-3u uncert_x10=%-2u history=%u | "
+         "latencia media %lu ms, %u/%u episodios sin activar, %u falsas\n",
+         label, k.q0_x100, k.r0_x10, k.stable_q8, k.uncert_x10, k.history,
+         hits ? (unsigned long)(s.latencyMs / hits) : 0UL, s.misses, s.episodes, s.falses);
+}
+
+int main(int argc, char **argv) {
+  unsigned maxFalses = 0;
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  int a = 1;
+  for (; a + 1 < argc && argv[a][0] == '-'; a += 2) {
+    if (!strcmp(argv[a], "-f")) maxFalses = atoi(argv[a + 1]);
+    else if (!strcmp(argv[a], "-j")) jobs = atol(argv[a + 1]);
+  }
+  if (a >= argc || (argc - a) % 2 != 0) {
+    fprintf(stderr, "uso: %s [-f falsas] [-j procesos] captura.log suave.csv [...]\n", argv[0]);
+    return 1;
+  }
+  if (jobs < 1) jobs = 1;
+
+  std::vector<Trace> traces((argc - a) / 2);
+  for (size_t t = 0; t < traces.size(); t++)
+    if (!load_trace(argv[a + 2 * t], argv[a + 2 * t + 1], traces[t])) return 1;
+
+  // Valores del sketch (los TUNABLE aún sin tocar) como comparación
+  Params sketch = {kalman_q0_x100, kalman_r0_x10, STABLE_THRESHOLD_Q8, UNCERT_THRESHOLD_X10, historySize};
+  std::vector<Params> grid;
+  for (uint8_t q : GRID_Q0_X100)
+    for (uint8_t r : GRID_R0_X10)
+      for (uint16_t s : GRID_STABLE_Q8)
+        for (uint8_t u : GRID_UNCERT_X10)
+          for (uint8_t h : GRID_HISTORY) {
+            Params k = {q, r, s, u, h};
+            grid.push_back(k);
+          }
+
+  // — Reparto: un hijo por (combinación, captura), hasta jobs a la vez —
+  // Cada hijo hereda el estado inicial intacto del sketch y devuelve un
+  // Result por la tubería (escritura atómica: menor que PIPE_BUF).
+  int fds[2];
+  if (pipe(fds) < 0) { perror("pipe"); return 1; }
+  std::vector<Score> scores(grid.size(), Score());
+  size_t total = grid.size() * traces.size(), next = 0, done = 0;
+  long running = 0;
+  while (done < total) {
+    while (running < jobs && next < total) {
+      pid_t pid = fork();
+      if (pid < 0) { perror("fork"); return 1; }
+      if (pid == 0) {
+        Result r = replay(grid[next / traces.size()], traces[next % traces.size()]);
+        r.job = next;
+        ssize_t w = write(fds[1], &r, sizeof(r));
+        _exit(w == (ssize_t)sizeof(r) ? 0 : 1);
+      }
+      next++;
+      running++;
+    }
+    Result r;
+    if (read(fds[0], &r, sizeof(r)) != (ssize_t)sizeof(r)) { perror("read"); return 1; }
+    wait(0);
+    running--;
+    done++;
+    Score &s = scores[r.job / traces.size()];
+    s.episodes += r.episodes;
+    s.misses += r.misses;
+    s.falses += r.falses;
+    s.latencyMs += r.latencyMs;
+  }
+
+  // — Mejor combinación factible y la del sketch como comparación —
+  printf("%zu combinaciones x %zu capturas, %ld procesos\n", grid.size(), traces.size(), jobs);
+  size_t best = grid.size();
+  for (size_t i = 0; i < grid.size(); i++) {
+    const Params &k = grid[i];
+    if (k.q0_x100 == sketch.q0_x100 && k.r0_x10 == sketch.r0_x10 && k.stable_q8 == sketch.stable_q8 &&
+        k.uncert_x10 == sketch.uncert_x10 && k.history == sketch.history)
+      print_score("sketch", k, scores[i]);
+    if (scores[i].falses > maxFalses) continue;
+    if (best == grid.size() || better(scores[i], scores[best])) best = i;
+  }
+  if (best == grid.size()) {
+    printf("ninguna combinación con %u activaciones falsas o menos\n", maxFalses);
+    return 2;
+  }
+  const Params &k = grid[best];
+  print_score("mejor", k, scores[best]);
+  printf("const uint8_t kalman_q0_x100 = %u;\n", k.q0_x100);
+  printf("const uint8_t kalman_r0_x10 = %u;\n", k.r0_x10);
+  printf("const uint16_t STABLE_THRESHOLD_Q8 = %u;\n", k.stable_q8);
+  printf("const uint8_t UNCERT_THRESHOLD_X10 = %u;\n", k.uncert_x10);
+  printf("#define HISTORY_SIZE %u\n", k.history);
+  return 0;
+}
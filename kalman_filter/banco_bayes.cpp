@@ -0,0 +1,512 @@
+// ============================================================
+//  BANCO DE RENDIMIENTO DEL FILTRO DE REJILLA (bayes_grid.h)
+//  Herramienta de PC (no es un sketch): mide el tiempo por ciclo
+//  (update + expected) y la precisión de BayesGrid frente a la versión
+//  original con gaussian() (pow, sqrt y exp por bin), con lecturas
+//  simuladas de dos sensores sobre un objeto quieto y uno en movimiento,
+//  y la actualización dispersa (Sparse) frente a la densa a varios STEP.
+//  En una sesión larga (horas de ciclos con la σ mínima de adaptive_noise)
+//  cuenta los reinicios de BayesGrid frente a la creencia logarítmica.
+//  Y la pasada fusionada de BayesGrid (posterior, total, media y varianza)
+//  frente a las tres pasadas anteriores (producto, normalizar, media):
+//  deben dar la misma media (±BENCH_FUSED_MEAN_CM) y varianza.
+//  Y dos sensores que discrepan 2-3 cm con σ = 0.2 (10-15σ): distancia de
+//  la estimación al punto medio y reinicios, frente a gaussian().
+//  La entera debe acabar a un bin del punto medio sin reiniciarse.
+//  Y la creencia entera (BayesIntGrid) frente a la flotante: SRAM y error.
+//  Y el paso de movimiento predict<R>() sobre un objeto que se acerca y se
+//  aleja: error de seguimiento con y sin predicción.
+//  Y la rejilla de dos niveles frente a una plana de la misma resolución
+//  en todo el alcance del HC-SR04: bytes, tiempo por ciclo y error.
+//  Y el filtro de partículas (filtro_particulas.h) frente a la rejilla y
+//  al Kalman 1D de filtrokalman.cpp, también con ecos espurios (zona
+//  difusa) y con un segundo objeto más profundo: error por ciclo y bytes.
+//  Los tiempos son del PC; en el AVR la diferencia es mayor porque cada
+//  pow/exp/sqrt en software cuesta miles de ciclos.
+//
+//  Compilar: g++ -std=gnu++11 -O3 -march=native -fopenmp -o banco_bayes banco_bayes.cpp
+//            (sin -fopenmp la pasada fusionada queda escalar; con
+//            -fopenmp-simd, añadir -DBAYES_HOST_SIMD)
+//  Uso:      ./banco_bayes [ciclos]
+//  Sale con 1 si la pasada fusionada se separa de las tres pasadas o si
+//  la creencia entera no aguanta a los sensores que discrepan.
+// ============================================================
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#if defined(_OPENMP) && !defined(BAYES_HOST_SIMD)
+#define BAYES_HOST_SIMD
+#endif
+#include "bayes_grid.h"
+#include "filtro_particulas.h"
+
+// Comprobaciones de equivalencia (las medidas de tiempo no fallan)
+#define BENCH_FUSED_MEAN_CM 5e-4   // media de la pasada fusionada frente a tres
+#define BENCH_FUSED_VAR_CM2 1e-5   // varianza final, ídem
+#define BENCH_DISAGREE_CM 0.1f     // entera frente al punto medio: un bin
+
+static int benchFailures = 0;
+
+#define BENCH_CHECK(cond, ...) \
+  do {                         \
+    if (!(cond)) {             \
+      printf("  FALLO: ");     \
+      printf(__VA_ARGS__);     \
+      printf("\n");            \
+      benchFailures++;         \
+    }                          \
+  } while (0)
+
+// — Rejilla original de carrito.cpp (antes de la tabla de verosimilitud) —
+template <uint16_t NumBins>
+struct ReferenceGrid {
+  float belief[NumBins];
+  float minDist, step;
+
+  ReferenceGrid(float minDist0, float step0) : minDist(minDist0), step(step0) { init(); }
+
+  void init() {
+    for (uint16_t i = 0; i < NumBins; i++) belief[i] = 1.0 / NumBins;
+  }
+
+  static float gaussian(float x, float mu, float sigma) {
+    float exponent = -pow(x - mu, 2) / (2 * pow(sigma, 2));
+    return (1.0 / (sqrt(2 * M_PI) * sigma)) * exp(exponent);
+  }
+
+  void update(const float z[2], const float sigma[2]) {
+    float total = 0;
+    for (uint16_t i = 0; i < NumBins; i++) {
+      float x = minDist + i * step;
+      belief[i] *= gaussian(z[0], x, sigma[0]) * gaussian(z[1], x, sigma[1]);
+      total += belief[i];
+    }
+    if (total > 0) {
+      for (uint16_t i = 0; i < NumBins; i++) belief[i] /= total;
+    } else {
+      init();
+    }
+  }
+
+  float expected() const {
+    float sum = 0, weight_sum = 0;
+    for (uint16_t i = 0; i < NumBins; i++) {
+      sum += (minDist + i * step) * belief[i];
+      weight_sum += belief[i];
+    }
+    return (weight_sum > 0) ? sum / weight_sum : minDist + (NumBins - 1) * step / 2;
+  }
+};
+
+// — BayesGrid densa en tres pasadas (antes de fusionarlas) —
+template <uint16_t NumBins>
+struct ThreePassGrid {
+  float belief[NumBins];
+  float minDist, step;
+
+  ThreePassGrid(float minDist0, float step0) : minDist(minDist0), step(step0) { init(); }
+
+  void init() {
+    for (uint16_t i = 0; i < NumBins; i++) belief[i] = 1.0 / NumBins;
+  }
+
+  void update(const float z[2], const float sigma[2]) {
+    BayesLikelihood l[2] = {bayes_likelihood(z[0], sigma[0], minDist, step),
+                            bayes_likelihood(z[1], sigma[1], minDist, step)};
+    float total = 0;
+    for (int16_t i = 0; i < NumBins; i++) {
+      belief[i] *= bayes_lookup(l[0], i) * bayes_lookup(l[1], i);
+      total += belief[i];
+    }
+    if (total > BAYES_MIN_TOTAL) {
+      // Las colas que BayesGrid::finish() anula (BAYES_TAIL_CUT del total)
+      const float cut = total * BAYES_TAIL_CUT;
+      for (int16_t i = 0; belief[i] <= cut; i++) belief[i] = 0;
+      for (int16_t i = NumBins - 1; belief[i] <= cut; i--) belief[i] = 0;
+      float inv = 1 / total;
+      for (uint16_t i = 0; i < NumBins; i++) belief[i] *= inv;
+    } else {
+      init();
+    }
+  }
+
+  float expected() const {
+    float sum = 0, weight_sum = 0;
+    for (uint16_t i = 0; i < NumBins; i++) {
+      sum += (minDist + i * step) * belief[i];
+      weight_sum += belief[i];
+    }
+    return (weight_sum > 0) ? sum / weight_sum : minDist + (NumBins - 1) * step / 2;
+  }
+};
+
+// — Lecturas simuladas: dos sensores con ruido gaussiano —
+struct Scenario {
+  const char *name;
+  std::vector<float> z;      // z1, z2 por ciclo
+  std::vector<float> truth;  // distancia real por ciclo
+};
+
+enum Motion { STILL, SWING, JUMPS, APPROACH, DIFFUSE, TWO_DEPTHS };
+
+static Scenario make_scenario(const char *name, Motion motion, size_t cycles, float minDist, float maxDist) {
+  Scenario s;
+  s.name = name;
+  std::mt19937 rng(1);
+  std::normal_distribution<float> noise(0, 0.3f);
+  std::uniform_real_distribution<float> place(minDist + 1, maxDist - 1);
+  std::mt19937 other(2);
+  std::uniform_real_distribution<float> clutter(0, 1);
+  float mid = (minDist + maxDist) / 2, span = (maxDist - minDist) / 3;
+  float near = minDist + 3, far = maxDist - 2;
+  for (size_t c = 0; c < cycles; c++) {
+    float d = mid;
+    if (motion == SWING) {
+      // Vaivén de ±span cm con periodo de 4 s (ciclos de 10 ms)
+      d = mid + span * sinf(c * 2 * (float)M_PI / 400);
+    } else if (motion == JUMPS) {
+      // El objeto cambia de sitio de golpe cada 5 s (otra mano)
+      if (c % 500 == 0) mid = place(rng);
+      d = mid;
+    } else if (motion == APPROACH) {
+      // Se acerca a 15 cm/s, espera 1 s, se aleja a 9 cm/s, espera 1 s
+      size_t in = (size_t)((far - near) / 0.15f), out = (size_t)((far - near) / 0.09f);
+      size_t t = c % (in + out + 200);
+      if (t < in) d = far + (near - far) * t / in;
+      else if (t < in + 100) d = near;
+      else if (t < in + 100 + out) d = near + (far - near) * (t - in - 100) / out;
+      else d = far;
+    }
+    s.truth.push_back(d);
+    for (int k = 0; k < 2; k++) {
+      float z = d + noise(rng);
+      // Otro generador: los escenarios anteriores no cambian
+      if (motion == DIFFUSE && clutter(other) < 0.2f) z = minDist + (maxDist - minDist) * clutter(other);
+      if (motion == TWO_DEPTHS && clutter(other) < 0.3f) z = d + 8 + noise(other);
+      s.z.push_back(z < minDist ? minDist : (z > maxDist ? maxDist : z));
+    }
+  }
+  return s;
+}
+
+// Reinicios por creencia nula (la logarítmica no tiene)
+template <typename Grid>
+static auto resets_of(const Grid &grid, int) -> decltype(grid.resets) { return grid.resets; }
+
+template <typename Grid>
+static uint32_t resets_of(const Grid &, long) { return 0; }
+
+// La rejilla con el paso de movimiento antes de cada actualización
+template <typename Grid, uint8_t R>
+struct Predicting : Grid {
+  using Grid::Grid;
+  void update(const float z[2], const float sigma[2]) {
+    this->template predict<R>();
+    Grid::update(z, sigma);
+  }
+};
+
+// Tiempo por ciclo (ns) y error medio absoluto frente a la distancia real
+template <typename Grid>
+static void run(const char *label, Grid &grid, const Scenario &s, std::vector<float> &estimates, float sd = 0.4f) {
+  const float sigma[2] = {sd, sd};
+  size_t cycles = s.truth.size();
+  estimates.resize(cycles);
+  grid.init();
+  uint32_t resets = resets_of(grid, 0);
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t c = 0; c < cycles; c++) {
+    grid.update(&s.z[2 * c], sigma);
+    estimates[c] = grid.expected();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double err = 0;
+  for (size_t c = 0; c < cycles; c++) err += fabs(estimates[c] - s.truth[c]);
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / cycles;
+  printf("  %-22s %9.0f ns/ciclo  error medio %.3f cm", label, ns, err / cycles);
+  if (resets_of(grid, 0) != resets) printf("  %u reinicios", resets_of(grid, 0) - resets);
+  printf("\n");
+}
+
+template <uint16_t NumBins>
+static void bench(const char *sketch, float minDist, float maxDist, float step, size_t cycles) {
+  printf("%s: %u bins de %.2f cm (%.0f-%.0f cm)\n", sketch, NumBins, step, minDist, maxDist);
+  static ReferenceGrid<NumBins> reference(minDist, step);
+  static BayesGrid<NumBins, 2> table(minDist, step);
+  const bool moving[] = {false, true};
+  for (bool m : moving) {
+    Scenario s = make_scenario(m ? "en movimiento" : "quieto", m ? SWING : STILL, cycles, minDist, maxDist);
+    printf(" objeto %s\n", s.name);
+    std::vector<float> a, b;
+    run("gaussian() original", reference, s, a);
+    run("tabla de verosimilitud", table, s, b);
+    double diff = 0;
+    for (size_t c = 0; c < cycles; c++) diff = fmax(diff, fabs(a[c] - b[c]));
+    printf("  diferencia máxima entre ambas: %.3f cm\n", diff);
+  }
+}
+
+// Densa frente a dispersa sobre 2-30 cm con el STEP de NumBins
+template <uint16_t NumBins>
+static void bench_sparse(size_t cycles) {
+  float step = 28.0f / (NumBins - 1);
+  printf("2-30 cm, %u bins de %.3f cm\n", NumBins, step);
+  static BayesGrid<NumBins, 2> dense(2, step);
+  static BayesGrid<NumBins, 2, true> sparse(2, step);
+  const bool moving[] = {false, true};
+  for (bool m : moving) {
+    Scenario s = make_scenario(m ? "en movimiento" : "quieto", m ? SWING : STILL, cycles, 2, 30);
+    printf(" objeto %s\n", s.name);
+    std::vector<float> a, b;
+    run("densa", dense, s, a);
+    run("dispersa", sparse, s, b);
+    double diff = 0;
+    for (size_t c = 0; c < cycles; c++) diff = fmax(diff, fabs(a[c] - b[c]));
+    printf("  diferencia máxima entre ambas: %.6f cm\n", diff);
+  }
+}
+
+// Sesión larga de carrito.cpp: σ = 0.2 (mínimo de adaptive_noise) con
+// lecturas de σ real 0.3, donde una lectura a más de 13σ de la creencia
+// la anula
+static void bench_log(size_t cycles) {
+  printf("carrito.cpp, %zu ciclos (%.1f h), σ del filtro 0.2 cm\n", cycles, cycles / 360000.0);
+  static BayesGrid<281, 2, true> linear(2, 0.1f);
+  static BayesLogGrid<281, 2> log2grid(2, 0.1f);
+  const char *names[] = {"quieto", "en movimiento", "con saltos"};
+  const Motion motions[] = {STILL, SWING, JUMPS};
+  for (int k = 0; k < 3; k++) {
+    Scenario s = make_scenario(names[k], motions[k], cycles, 2, 30);
+    printf(" objeto %s\n", s.name);
+    std::vector<float> a, b;
+    run("lineal (dispersa)", linear, s, a, 0.2f);
+    run("logarítmica", log2grid, s, b, 0.2f);
+  }
+}
+
+// Sensores que discrepan: z1 = 10 cm y z2 = 10 + gap con σ = 0.2 durante
+// 50 ciclos; el error es frente al punto medio, donde gaussian() deja la
+// media. Con la tabla hasta 4.75σ cada ciclo anulaba la creencia y se
+// reiniciaba (16 cm, el centro); la entera funde las mediciones antes de
+// la tabla (ver BayesIntGrid) y debe quedarse en el punto medio sin reiniciar
+static void bench_disagree() {
+  printf("carrito.cpp, σ del filtro 0.2 cm, 50 ciclos con z1 = 10 cm\n");
+  static ReferenceGrid<281> reference(2, 0.1f);
+  static BayesGrid<281, 2> dense(2, 0.1f);
+  static BayesGrid<281, 2, true> sparse(2, 0.1f);
+  static BayesIntGrid<281, 2, true> integer(2, 0.1f);
+  const float gaps[] = {2.0f, 2.5f, 3.0f};
+  for (float gap : gaps) {
+    Scenario s;
+    s.name = "discrepantes";
+    for (int c = 0; c < 50; c++) {
+      s.z.push_back(10);
+      s.z.push_back(10 + gap);
+      s.truth.push_back(10 + gap / 2);
+    }
+    printf(" z2 = %.1f cm (%.1fσ)\n", 10 + gap, gap / 0.2f);
+    std::vector<float> a;
+    run("gaussian() original", reference, s, a, 0.2f);
+    run("tabla, densa", dense, s, a, 0.2f);
+    run("tabla, dispersa", sparse, s, a, 0.2f);
+    uint32_t resets = integer.resets;
+    run("uint16_t, dispersa", integer, s, a, 0.2f);
+    float off = fabs(integer.expected() - (10 + gap / 2));
+    BENCH_CHECK(integer.resets == resets, "z2 = %.1f cm: la entera se reinicia %u veces", 10 + gap,
+                integer.resets - resets);
+    BENCH_CHECK(off <= BENCH_DISAGREE_CM, "z2 = %.1f cm: la entera acaba a %.3f cm del punto medio", 10 + gap, off);
+  }
+}
+
+// Tres pasadas frente a la fusionada, densas (la dispersa apenas recorre
+// bins); el mejor de varios intentos para quitar ruido del PC
+template <uint16_t NumBins>
+static void bench_fused(size_t cycles) {
+  float step = 28.0f / (NumBins - 1);
+  printf("2-30 cm, %u bins de %.3f cm (objeto en movimiento)\n", NumBins, step);
+  static ThreePassGrid<NumBins> three(2, step);
+  static BayesGrid<NumBins, 2> fused(2, step);
+  Scenario s = make_scenario("en movimiento", SWING, cycles, 2, 30);
+  const float sigma[2] = {0.4f, 0.4f};
+  std::vector<float> reference(cycles);
+  double best[2] = {1e30, 1e30}, diff = 0;
+  for (int rep = 0; rep < 5; rep++) {
+    three.init();
+    fused.init();
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < cycles; c++) {
+      three.update(&s.z[2 * c], sigma);
+      reference[c] = three.expected();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < cycles; c++) {
+      fused.update(&s.z[2 * c], sigma);
+      diff = fmax(diff, fabs(fused.expected() - reference[c]));
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    best[0] = fmin(best[0], std::chrono::duration<double, std::nano>(t1 - t0).count() / cycles);
+    best[1] = fmin(best[1], std::chrono::duration<double, std::nano>(t2 - t1).count() / cycles);
+  }
+  // Varianza fusionada frente a la de la creencia normalizada de tres pasadas
+  float m = three.expected(), v = 0;
+  for (uint16_t i = 0; i < NumBins; i++) v += (2 + i * step - m) * (2 + i * step - m) * three.belief[i];
+  double varErr = fabs(fused.variance() - v);
+  printf("  tres pasadas %9.0f ns/ciclo\n  fusionada    %9.0f ns/ciclo (x%.1f)\n", best[0], best[1], best[0] / best[1]);
+  printf("  diferencia máxima de la media %.6f cm, de la varianza final %.2g cm²\n", diff, varErr);
+  BENCH_CHECK(diff <= BENCH_FUSED_MEAN_CM, "%u bins: la media fusionada se separa %.6f cm", NumBins, diff);
+  BENCH_CHECK(varErr <= BENCH_FUSED_VAR_CM2, "%u bins: la varianza fusionada se separa %.2g cm²", NumBins, varErr);
+}
+
+// Flotante frente a entera con la misma dispersión; bytes de la creencia
+template <uint16_t NumBins, bool Sparse>
+static void bench_int(const char *sketch, float minDist, float maxDist, float step, size_t cycles) {
+  static BayesGrid<NumBins, 2, Sparse> real(minDist, step);
+  static BayesIntGrid<NumBins, 2, Sparse> integer(minDist, step);
+  printf("%s, %s: creencia de %zu bytes (float) y %zu bytes (uint16_t)\n", sketch, Sparse ? "dispersa" : "densa",
+         sizeof(real.belief), sizeof(integer.belief));
+  const char *names[] = {"quieto", "en movimiento", "con saltos"};
+  const Motion motions[] = {STILL, SWING, JUMPS};
+  for (int k = 0; k < 3; k++) {
+    Scenario s = make_scenario(names[k], motions[k], cycles, minDist, maxDist);
+    printf(" objeto %s\n", s.name);
+    std::vector<float> a, b;
+    run("float", real, s, a);
+    run("uint16_t", integer, s, b);
+    double diff = 0, sum = 0;
+    for (size_t c = 0; c < cycles; c++) {
+      diff = fmax(diff, fabs(a[c] - b[c]));
+      sum += fabs(a[c] - b[c]);
+    }
+    printf("  diferencia entre ambas: media %.4f cm, máxima %.3f cm\n", sum / cycles, diff);
+  }
+}
+
+// Error de seguimiento con y sin paso de movimiento, a varios radios
+template <uint16_t NumBins>
+static void bench_predict(const char *sketch, float minDist, float maxDist, float step, size_t cycles) {
+  printf("%s: %u bins de %.2f cm, dispersa\n", sketch, NumBins, step);
+  static BayesGrid<NumBins, 2, true> none(minDist, step);
+  static Predicting<BayesGrid<NumBins, 2, true>, 1> r1(minDist, step);
+  static Predicting<BayesGrid<NumBins, 2, true>, 2> r2(minDist, step);
+  static Predicting<BayesGrid<NumBins, 2, true>, 4> r4(minDist, step);
+  static Predicting<BayesGrid<NumBins, 2, true>, 7> r7(minDist, step);
+  static Predicting<BayesIntGrid<NumBins, 2, true>, 4> int4(minDist, step);
+  static Predicting<BayesLogGrid<NumBins, 2>, 4> log4(minDist, step);
+  const char *names[] = {"que se acerca y se aleja", "en movimiento", "quieto"};
+  const Motion motions[] = {APPROACH, SWING, STILL};
+  for (int k = 0; k < 3; k++) {
+    Scenario s = make_scenario(names[k], motions[k], cycles, minDist, maxDist);
+    printf(" objeto %s\n", s.name);
+    std::vector<float> a;
+    run("sin predicción", none, s, a);
+    run("R = 1", r1, s, a);
+    run("R = 2", r2, s, a);
+    run("R = 4", r4, s, a);
+    run("R = 7", r7, s, a);
+    run("R = 4, uint16_t", int4, s, a);
+    run("R = 4, logarítmica", log4, s, a);
+  }
+}
+
+// 2-400 cm a 0.1 cm: plana (3981 bins) frente a gruesa de 4 cm + fina de 128
+static void bench_two_level(size_t cycles) {
+  static Predicting<BayesGrid<3981, 2>, 4> flat(2, 0.1f);
+  static Predicting<BayesGrid<3981, 2, true>, 4> flatSparse(2, 0.1f);
+  static Predicting<BayesTwoLevelGrid<100, 128, 2>, 4> twoLevel(2, 4, 0.1f);
+  printf("2-400 cm a 0.1 cm: plana %zu bytes, de dos niveles %zu bytes (100 bins de 4 cm + 128 de 0.1 cm)\n",
+         sizeof(flat), sizeof(twoLevel));
+  const char *names[] = {"que se acerca y se aleja", "quieto", "con saltos"};
+  const Motion motions[] = {APPROACH, STILL, JUMPS};
+  for (int k = 0; k < 3; k++) {
+    Scenario s = make_scenario(names[k], motions[k], cycles, 2, 400);
+    printf(" objeto %s\n", s.name);
+    std::vector<float> a;
+    run("plana", flat, s, a);
+    run("plana dispersa", flatSparse, s, a);
+    run("dos niveles", twoLevel, s, a);
+  }
+}
+
+// Kalman 1D de filtrokalman.cpp en el hueco de la rejilla: r = σ²
+struct KalmanSlot {
+  KalmanFilter<float, 1, 2> kf;
+  float x0;
+
+  KalmanSlot(float minDist, float maxDist) : kf((minDist + maxDist) / 2, 1.0f, 0.01f), x0((minDist + maxDist) / 2) {}
+
+  void init() {
+    kf.x = x0;
+    kf.p = 1.0f;
+  }
+
+  void update(const float z[2], const float sigma[2]) {
+    const float r[2] = {sigma[0] * sigma[0], sigma[1] * sigma[1]};
+    kf.predict();
+    kf.update(z, r);
+  }
+
+  float expected() const { return kf.x; }
+};
+
+// Partículas frente a rejilla y Kalman con el mismo paso de movimiento
+template <uint16_t NumBins>
+static void bench_particles(const char *sketch, float minDist, float maxDist, float step, size_t cycles) {
+  static KalmanSlot kalman(minDist, maxDist);
+  static Predicting<BayesGrid<NumBins, 2, true>, 4> grid(minDist, step);
+  static Predicting<ParticleFilter<96, 2>, 4> particles(minDist, maxDist, step);
+  static Predicting<ParticleFilter<48, 2>, 4> fewer(minDist, maxDist, step);
+  printf("%s: Kalman %zu bytes, rejilla %zu bytes, partículas %zu bytes (96) y %zu bytes (48)\n", sketch,
+         sizeof(kalman.kf), sizeof(grid), sizeof(particles), sizeof(fewer));
+  const char *names[] = {"que se acerca y se aleja", "quieto", "con saltos", "en la zona difusa (20% espurios)",
+                         "con otro 8 cm detrás (30% de ecos)"};
+  const Motion motions[] = {APPROACH, STILL, JUMPS, DIFFUSE, TWO_DEPTHS};
+  for (int k = 0; k < 5; k++) {
+    Scenario s = make_scenario(names[k], motions[k], cycles, minDist, maxDist);
+    printf(" objeto %s\n", s.name);
+    std::vector<float> a;
+    run("Kalman 1D", kalman, s, a);
+    run("rejilla dispersa, R = 4", grid, s, a);
+    run("96 partículas, R = 4", particles, s, a);
+    run("48 partículas, R = 4", fewer, s, a);
+  }
+}
+
+int main(int argc, char **argv) {
+  size_t cycles = argc > 1 ? atol(argv[1]) : 20000;
+  printf("— Tabla de verosimilitud —\n");
+  bench<281>("carrito.cpp", 2, 30, 0.1f, cycles);
+  bench<131>("carrito2.cpp / filtrokalman2.cpp", 2, 15, 0.1f, cycles);
+  printf("— Actualización dispersa —\n");
+  bench_sparse<281>(cycles);
+  bench_sparse<561>(cycles);
+  bench_sparse<1401>(cycles);
+  bench_sparse<2801>(cycles);
+  printf("— Creencia logarítmica —\n");
+  bench_log(cycles * 50);
+  printf("— Pasada fusionada —\n");
+  bench_fused<281>(cycles);
+  bench_fused<561>(cycles);
+  bench_fused<1401>(cycles);
+  bench_fused<2801>(cycles);
+  printf("— Sensores que discrepan —\n");
+  bench_disagree();
+  printf("— Creencia entera —\n");
+  bench_int<281, true>("carrito.cpp", 2, 30, 0.1f, cycles);
+  bench_int<281, false>("carrito.cpp", 2, 30, 0.1f, cycles);
+  bench_int<131, false>("carrito2.cpp / filtrokalman2.cpp", 2, 15, 0.1f, cycles);
+  printf("— Paso de movimiento —\n");
+  bench_predict<281>("carrito.cpp", 2, 30, 0.1f, cycles);
+  bench_predict<131>("carrito2.cpp", 2, 15, 0.1f, cycles);
+  printf("— Rejilla de dos niveles —\n");
+  bench_two_level(cycles);
+  printf("— Filtro de partículas —\n");
+  bench_particles<281>("carrito.cpp", 2, 30, 0.1f, cycles);
+  bench_particles<131>("carrito2.cpp", 2, 15, 0.1f, cycles);
+  printf(benchFailures ? "%d comprobaciones fallidas\n" : "todo correcto\n", benchFailures);
+  return benchFailures ? 1 : 0;
+}
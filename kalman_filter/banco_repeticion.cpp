@@ -0,0 +1,99 @@
+// ============================================================
+//  BANCO DE LA RÉPLICA EN EL PC (bayes_host.h)
+//  Herramienta de PC (no es un sketch): fotogramas por segundo de un
+//  núcleo con la lógica de carrito.cpp por fotograma (adaptive_noise,
+//  update_belief con predict<4> y expected_value: BayesHostCarrito) con
+//  BayesGrid y con BayesHostGrid en cada backend que admita la CPU, sobre
+//  lecturas simuladas de un objeto que se acerca y se aleja (1% sin eco).
+//  Cada configuración: el mejor de varios intentos y la diferencia máxima
+//  de la estimación frente a BayesGrid.
+//  Se compila SIN -march=native: la pasada AVX2 se elige al arrancar, y
+//  BayesGrid y el backend genérico quedan con las instrucciones de base.
+//
+//  Compilar: g++ -std=gnu++11 -O3 -o banco_repeticion banco_repeticion.cpp
+//  Uso:      ./banco_repeticion [fotogramas]
+// ============================================================
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "bayes_host.h"
+
+const uint8_t MOTION_RADIUS = 4;  // el de carrito.cpp y carrito2.cpp
+
+// — Lecturas simuladas: z1, z2 por fotograma (-1 sin eco) —
+static std::vector<float> make_trace(size_t frames, float minDist, float maxDist) {
+  std::vector<float> z(2 * frames);
+  std::mt19937 rng(1);
+  std::normal_distribution<float> noise(0, 0.3f);
+  std::uniform_real_distribution<float> echo(0, 1);
+  float near = minDist + 3, far = maxDist - 2;
+  // Se acerca a 15 cm/s, espera 1 s, se aleja a 9 cm/s, espera 1 s
+  size_t in = (size_t)((far - near) / 0.15f), out = (size_t)((far - near) / 0.09f);
+  for (size_t c = 0; c < frames; c++) {
+    size_t t = c % (in + out + 200);
+    float d = far;
+    if (t < in) d = far + (near - far) * t / in;
+    else if (t < in + 100) d = near;
+    else if (t < in + 100 + out) d = near + (far - near) * (t - in - 100) / out;
+    for (int k = 0; k < 2; k++) {
+      float v = d + noise(rng);
+      z[2 * c + k] = (echo(rng) < 0.01f) ? -1 : (v < minDist ? minDist : (v > maxDist ? maxDist : v));
+    }
+  }
+  return z;
+}
+
+// Fotogramas por segundo (el mejor de reps intentos) y estimaciones
+template <typename Sketch>
+static double replay(Sketch &sketch, const std::vector<float> &z, std::vector<float> &estimates, int reps = 5) {
+  size_t frames = z.size() / 2;
+  estimates.resize(frames);
+  double best = 1e30;
+  for (int rep = 0; rep < reps; rep++) {
+    sketch.init();
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < frames; c++) estimates[c] = sketch.cycle(z[2 * c], z[2 * c + 1]);
+    auto t1 = std::chrono::steady_clock::now();
+    best = fmin(best, std::chrono::duration<double>(t1 - t0).count());
+  }
+  return frames / best;
+}
+
+template <uint16_t NumBins, bool Sparse>
+static void bench(const char *sketch, float minDist, float maxDist, float step, size_t frames) {
+  printf("%s: %u bins de %.2f cm, %s, R = %u\n", sketch, NumBins, step, Sparse ? "dispersa" : "densa", MOTION_RADIUS);
+  std::vector<float> z = make_trace(frames, minDist, maxDist);
+  static BayesHostCarrito<BayesGrid<NumBins, 2, Sparse>, MOTION_RADIUS> reference(minDist, maxDist, step);
+  std::vector<float> expected, estimates;
+  double fps = replay(reference, z, expected);
+  printf("  %-22s %8.2f M fotogramas/s\n", "BayesGrid", fps / 1e6);
+  const char *names[] = {"generico", "avx2"};
+  for (const char *name : names) {
+    const BayesHostBackend *b = bayes_host_find(name);
+    if (!b) {
+      printf("  %-22s (no disponible en esta CPU)\n", name);
+      continue;
+    }
+    static BayesHostCarrito<BayesHostGrid<NumBins, 2, Sparse>, MOTION_RADIUS> host(minDist, maxDist, step, *b);
+    host = BayesHostCarrito<BayesHostGrid<NumBins, 2, Sparse>, MOTION_RADIUS>(minDist, maxDist, step, *b);
+    double f = replay(host, z, estimates);
+    double diff = 0;
+    for (size_t c = 0; c < frames; c++) diff = fmax(diff, fabs(estimates[c] - expected[c]));
+    printf("  %-22s %8.2f M fotogramas/s (x%.1f)  diferencia máxima %.2g cm\n", name, f / 1e6, f / fps, diff);
+  }
+}
+
+int main(int argc, char **argv) {
+  size_t frames = argc > 1 ? atol(argv[1]) : 1000000;
+  printf("Backend elegido en esta CPU: %s\n", bayes_host_backend().name);
+  bench<281, true>("carrito.cpp", 2, 30, 0.1f, frames);
+  bench<281, false>("carrito.cpp sin BAYES_SPARSE", 2, 30, 0.1f, frames);
+  bench<131, false>("carrito2.cpp", 2, 15, 0.1f, frames);
+  bench<2801, true>("2-30 cm a 0.01 cm", 2, 30, 0.01f, frames / 10);
+  return 0;
+}
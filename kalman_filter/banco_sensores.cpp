@@ -0,0 +1,61 @@
+// ============================================================
+//  BANCO DE TAMAÑO Y COSTE DE LA ADQUISICIÓN (filtrokalman5.cpp)
+//  Herramienta de PC (no es un sketch): compila un sketch sobre nucleo_pc.h
+//  (SKETCH, por defecto filtrokalman5.cpp) con dos HC-SR04 simulados a 40
+//  y 41 cm en los pines 11/12 y 3/4, y mide lo que cuesta loop() en el PC:
+//  ns por llamada durante 600 s simulados, el mejor de 3 tramos.
+//  El tamaño sale del objeto de la misma compilación con nm: solo las
+//  funciones del sketch, sin el núcleo simulado ni la biblioteca (abajo).
+//  Para comparar con otra revisión, por ejemplo la anterior a SensorArray:
+//      git show 41d0a5b^:kalman_filter/filtrokalman5.cpp |
+//        sed '/avr\/pgmspace/d' > /tmp/antes.cpp
+//  y compilar igual con -DSKETCH='"/tmp/antes.cpp"' -I.
+//  Son medidas de x86-64, no del AVR: allí el tamaño lo da avr-size sobre
+//  el .elf que deja el IDE (avr-size -C --mcu=atmega328p), y los ciclos
+//  un simulador (simavr); aquí no hay ninguno de los dos.
+//
+//  Compilar: g++ -std=gnu++11 -O2 -o banco_sensores banco_sensores.cpp
+//  Tamaño:   g++ -std=gnu++11 -Os -c -o banco_sensores.o banco_sensores.cpp
+//            nm -C -S -t d --defined-only banco_sensores.o | awk '$3 ~ /^[tTW]$/ &&
+//              $4 !~ /^(pc_|Pc|std::|__gnu|main|_GLOBAL|Serial|operator|__cxx|digitalWrite|interrupts)/ {
+//              s += $2 } END { print s " bytes" }'
+//  Uso:      ./banco_sensores
+// ============================================================
+
+#include <chrono>
+
+#include "nucleo_pc.h"
+#include "kalman.h"
+
+#ifndef SKETCH
+#define SKETCH "filtrokalman5.cpp"
+#endif
+#include SKETCH
+
+#define SEGMENTS 3
+#define SEGMENT_US 200000000UL  // 200 s simulados por tramo
+
+int main() {
+  pc_attach(11, 12);
+  pc_attach(3, 4);
+  pcSonar[0].distanceCm = 40;
+  pcSonar[1].distanceCm = 41;
+  setup();
+  double best = 1e30;
+  unsigned long calls = 0;
+  for (int s = 0; s < SEGMENTS; s++) {
+    unsigned long n = 0, end = pcMicros + SEGMENT_US;
+    auto t0 = std::chrono::steady_clock::now();
+    while (pcMicros < end) {
+      loop();
+      n++;
+      pc_advance_to(pcMicros + 20);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+    if (ns < best) best = ns;
+    calls += n;
+  }
+  printf("%s: %lu llamadas a loop(), %.1f ns por llamada\n", SKETCH, calls, best);
+  return 0;
+}
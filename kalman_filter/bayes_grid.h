@@ -0,0 +1,740 @@
+// ============================================================
+//  FILTRO BAYESIANO DE REJILLA PARA carrito*.cpp Y filtrokalman2.cpp
+//  BayesGrid<NumBins, MeasDim>: creencia discreta sobre NumBins distancias
+//  MIN_DIST + i * STEP, actualizada con MeasDim sensores por ciclo.
+//  La verosimilitud gaussiana sale de una tabla en flash indexada por
+//  |z - x| / σ: sin pow, sqrt ni exp en el AVR (sin FPU).
+//  Con Sparse solo se recorren los bins donde la creencia puede no ser
+//  cero (el rango activo): coste proporcional a σ / STEP, no al alcance.
+//  Una sola pasada por ciclo: posterior, total, media y varianza juntos.
+//  predict<R>() es el paso de movimiento: convoluciona la creencia con un
+//  núcleo binomial de 2R + 1 bins antes de cada actualización.
+//  BayesTwoLevelGrid: rejilla gruesa en todo el alcance y una fina que se
+//  desplaza con el objeto (resolución fina sin pagar bins finos en todo).
+//  BayesIntGrid guarda la creencia en uint16_t (la mitad de SRAM) y no
+//  usa coma flotante por bin: productos enteros y normalización por bytes.
+//  BayesLogGrid guarda la creencia en log2 entero: actualizar es sumar,
+//  no hay pasada de normalización y nunca se reinicia.
+//  Solo cabecera, como kalman.h (del que toma PROGMEM y KalmanMakeIndex).
+//  bayes_host.h añade, solo en el PC, una BayesGrid con pasadas AVX2.
+// ============================================================
+
+#ifndef BAYES_GRID_H
+#define BAYES_GRID_H
+
+#include <math.h>
+
+#include "kalman.h"
+
+// — Verosimilitud tabulada: exp(-u²/2) con u = |z - x| / σ —
+// BAYES_LUT_RES entradas por σ, escaladas a 65535 en el pico. La constante
+// 1/(√(2π)·σ) es igual en todos los bins y se va al normalizar. Dos tablas:
+// - float hasta 13σ (BayesGrid), donde el exp() en float del gaussian()
+//   original desbordaba por abajo. Dos sensores que discrepan 10σ dejan
+//   e^-25 entre ambos, no 0: la creencia queda en medio y no se reinicia.
+// - Q16 hasta 4.75σ, donde 65535·exp(-u²/2) redondea a 0 (BayesIntGrid y
+//   ParticleFilter, todo enteros).
+// Más allá la verosimilitud es 0: si el objeto sale de la creencia, el
+// total cae a 0 y se reinicia. Ese 0 es una entrada más al final de cada
+// tabla, así la lectura no tiene condición.
+#define BAYES_LUT_RES 32
+#define BAYES_LUT_SIZE 417      // 13 * BAYES_LUT_RES + 1 (sin contar el 0 final)
+#define BAYES_LUT_Q16_SIZE 153  // 4.75 * BAYES_LUT_RES + 1 (sin contar el 0 final)
+#define BAYES_MIN_TOTAL 1e-30f
+#define BAYES_TAIL_CUT 6e-8f  // 2^-24: por debajo de la resolución de un total en float
+
+// e^a en compilación: serie de Taylor de e^(a/16) elevada a 16
+constexpr double bayes_exp_series(double x, uint8_t n, double term) {
+  return (n > 16) ? term : term + bayes_exp_series(x, n + 1, term * x / n);
+}
+
+constexpr double bayes_sq(double y) { return y * y; }
+
+constexpr double bayes_exp(double a) {
+  return bayes_sq(bayes_sq(bayes_sq(bayes_sq(bayes_exp_series(a / 16, 1, 1)))));
+}
+
+constexpr uint16_t bayes_lut_round(double v) {
+  return (uint16_t)(v + 0.5);
+}
+
+constexpr double bayes_lut_value(uint16_t i) {
+  return 65535.0 / bayes_exp((double)i * i / (2.0 * BAYES_LUT_RES * BAYES_LUT_RES));
+}
+
+constexpr float bayes_lut_entry(uint16_t i) {
+  return (i >= BAYES_LUT_SIZE) ? 0 : (float)bayes_lut_value(i);
+}
+
+constexpr uint16_t bayes_lut_q16_entry(uint16_t i) {
+  return (i >= BAYES_LUT_Q16_SIZE) ? 0 : bayes_lut_round(bayes_lut_value(i));
+}
+
+// En el PC el bucle fusionado se vectoriza si se permite reordenar sus
+// sumas: BAYES_HOST_SIMD pone un #pragma omp simd, que solo se define
+// cuando el compilador lo entiende (si no, -Wall avisa). g++ -fopenmp
+// define _OPENMP; -fopenmp-simd no, y ahí va -DBAYES_HOST_SIMD. En el AVR no.
+#ifdef BAYES_HOST_SIMD
+#define BAYES_SIMD_SUMS _Pragma("omp simd reduction(+ : total, sum1, sum2)")
+#else
+#define BAYES_SIMD_SUMS
+#endif
+
+template <typename L>
+struct BayesLikelihoodTable;
+
+template <uint16_t... I>
+struct BayesLikelihoodTable<KalmanIndexList<I...> > {
+  static const float data[sizeof...(I)];
+};
+
+template <uint16_t... I>
+const float BayesLikelihoodTable<KalmanIndexList<I...> >::data[sizeof...(I)] PROGMEM = {
+  bayes_lut_entry(I)...
+};
+
+template <typename L>
+struct BayesLikelihoodQ16Table;
+
+template <uint16_t... I>
+struct BayesLikelihoodQ16Table<KalmanIndexList<I...> > {
+  static const uint16_t data[sizeof...(I)];
+};
+
+template <uint16_t... I>
+const uint16_t BayesLikelihoodQ16Table<KalmanIndexList<I...> >::data[sizeof...(I)] PROGMEM = {
+  bayes_lut_q16_entry(I)...
+};
+
+// Cada una solo ocupa flash si alguna rejilla la usa
+typedef BayesLikelihoodTable<KalmanMakeIndex<BAYES_LUT_SIZE + 1>::type> BayesLikelihoodLut;
+typedef BayesLikelihoodQ16Table<KalmanMakeIndex<BAYES_LUT_Q16_SIZE + 1>::type> BayesLikelihoodQ16Lut;
+
+// Una medición preparada para el ciclo: bin de z y entradas de tabla por bin
+struct BayesLikelihood {
+  int16_t center;   // bin más cercano a z (la rejilla cuantiza z a STEP)
+  uint32_t scale;   // Q16: BAYES_LUT_RES · STEP / σ
+  int16_t reach;    // bins a cada lado de center con verosimilitud no nula
+  int16_t reachQ16; // lo mismo con la tabla Q16
+};
+
+// Bin más cercano a z
+inline int16_t bayes_bin(float z, float minDist, float step) {
+  return (int16_t)((z - minDist) / step + 0.5f);
+}
+
+// Única aritmética flotante por sensor y ciclo
+inline BayesLikelihood bayes_likelihood(float z, float sigma, float minDist, float step) {
+  BayesLikelihood l;
+  l.center = bayes_bin(z, minDist, step);
+  l.scale = (uint32_t)(BAYES_LUT_RES * 65536.0f * step / sigma);
+  // último d con índice en la tabla
+  l.reach = (((uint32_t)BAYES_LUT_SIZE << 16) - 0x8001) / l.scale;
+  l.reachQ16 = (((uint32_t)BAYES_LUT_Q16_SIZE << 16) - 0x8001) / l.scale;
+  return l;
+}
+
+// Sin eco: verosimilitud constante (entrada 0 en todos los bins), que se va
+// al normalizar; así el bucle por bin recorre siempre MeasDim mediciones
+inline BayesLikelihood bayes_likelihood_none() {
+  BayesLikelihood l = {0, 0, 0x7FFF, 0x7FFF};
+  return l;
+}
+
+// Índice de tabla del bin i, saturado al 0 final: un producto entero
+inline uint32_t bayes_lut_index(const BayesLikelihood &l, int16_t i, uint16_t size) {
+  uint16_t d = (i > l.center) ? i - l.center : l.center - i;
+  uint32_t idx = ((uint32_t)d * l.scale + 0x8000) >> 16;
+  return (idx > size) ? size : idx;
+}
+
+// Verosimilitud del bin i (65535 en el pico): una lectura de flash
+inline float bayes_lookup(const BayesLikelihood &l, int16_t i) {
+  return pgm_read_float(&BayesLikelihoodLut::data[bayes_lut_index(l, i, BAYES_LUT_SIZE)]);
+}
+
+// La misma en Q16, para las rejillas enteras
+inline uint16_t bayes_lookup_q16(const BayesLikelihood &l, int16_t i) {
+  return pgm_read_word(&BayesLikelihoodQ16Lut::data[bayes_lut_index(l, i, BAYES_LUT_Q16_SIZE)]);
+}
+
+// — Predicción: núcleo de movimiento binomial —
+// Entre dos lecturas el objeto se mueve: la creencia se convoluciona con
+// C(2R, k) / 4^R, k = 0..2R, una gaussiana discreta de varianza R/2 bins²
+// con coeficientes enteros que suman una potencia de 2 (la rejilla entera
+// divide con un desplazamiento). Sin este paso la creencia solo se afila y
+// un objeto en movimiento la vacía hasta reiniciarla.
+#define BAYES_PREDICT_BLOCK 16  // bins por bloque de la ventana deslizante
+
+constexpr uint16_t bayes_binomial(uint8_t n, uint8_t k) {
+  return (k == 0 || k == n) ? 1 : bayes_binomial(n - 1, k - 1) + bayes_binomial(n - 1, k);
+}
+
+template <uint8_t R, typename L>
+struct BayesMotionTable;
+
+template <uint8_t R, uint16_t... I>
+struct BayesMotionTable<R, KalmanIndexList<I...> > {
+  static const uint16_t data[sizeof...(I)];
+};
+
+template <uint8_t R, uint16_t... I>
+const uint16_t BayesMotionTable<R, KalmanIndexList<I...> >::data[sizeof...(I)] PROGMEM = {
+  bayes_binomial(2 * R, I)...
+};
+
+template <uint8_t R>
+struct BayesMotionKernel : BayesMotionTable<R, typename KalmanMakeIndex<2 * R + 1>::type> {};
+
+// Convolución en su sitio de belief[lo..hi] (fuera vale pad): una ventana
+// de BAYES_PREDICT_BLOCK + 2R valores originales se desliza por bloques de
+// tamaño fijo, así no hace falta una segunda rejilla en SRAM y el bucle por
+// bloque se desenrolla (y en el PC se vectoriza). kernel(win) da el bin
+// central de win[0..2R]. El rango crece R bins por lado, sin salir de la
+// rejilla: lo que cae fuera se pierde.
+template <uint8_t R, typename T, typename F>
+inline void bayes_slide(T *belief, int16_t &lo, int16_t &hi, int16_t numBins, T pad, F kernel) {
+  int16_t first = (lo - R > 0) ? lo - R : 0;
+  int16_t last = (hi + R < numBins - 1) ? hi + R : numBins - 1;
+  T win[BAYES_PREDICT_BLOCK + 2 * R];
+  for (uint8_t j = 0; j < 2 * R; j++) {
+    int16_t k = first - R + j;
+    win[j] = (k >= lo && k <= hi) ? belief[k] : pad;
+  }
+  for (int16_t base = first; base <= last; base += BAYES_PREDICT_BLOCK) {
+    uint8_t n = (last - base + 1 < BAYES_PREDICT_BLOCK) ? last - base + 1 : BAYES_PREDICT_BLOCK;
+    for (uint8_t j = 0; j < n; j++) {
+      int16_t k = base + R + j;
+      win[2 * R + j] = (k >= lo && k <= hi) ? belief[k] : pad;
+    }
+    for (uint8_t j = 0; j < n; j++) belief[base + j] = kernel(&win[j]);
+    for (uint8_t j = 0; j < 2 * R; j++) win[j] = win[n + j];
+  }
+  lo = first;
+  hi = last;
+}
+
+// — Filtro de rejilla —
+// Fuera del rango activo [lo, hi] la creencia es exactamente 0: la
+// verosimilitud tabulada se anula a 13σ y un producto nulo no revive.
+// Con Sparse cada actualización recorre solo la intersección del rango
+// activo con el soporte de cada medición; el resultado es idéntico al de
+// recorrer toda la rejilla (salvo el orden de las sumas con
+// BAYES_HOST_SIMD). Sin Sparse el rango es siempre la rejilla entera. En
+// las dos, las colas de menos de BAYES_TAIL_CUT del total se anulan.
+//
+// Normalización diferida: belief queda sin normalizar (belief · norm suma
+// 1) y norm se aplica en el producto del ciclo siguiente, no en una pasada
+// aparte. La media y la varianza salen de los momentos acumulados en la
+// misma pasada, en bins relativos a la primera lectura: sin recalcular
+// x = MIN_DIST + i · STEP por bin y sin cancelación en Σd²·b - media².
+template <uint16_t NumBins, uint8_t MeasDim, bool Sparse = false>
+class BayesGrid {
+public:
+  float belief[NumBins];  // sin normalizar: multiplicar por norm
+  float norm;
+  int16_t lo, hi;         // rango activo (inclusive)
+  uint32_t resets = 0;    // reinicios por creencia nula (diagnóstico)
+
+  BayesGrid(float minDist0, float step0) : minDist(minDist0), step(step0) { init(); }
+
+  // Distribución uniforme
+  void init() {
+    for (uint16_t i = 0; i < NumBins; i++) belief[i] = 1.0 / NumBins;
+    norm = 1;
+    lo = 0;
+    hi = NumBins - 1;
+    mean = minDist + (NumBins - 1) * step / 2;
+    var = step * step * ((float)NumBins * NumBins - 1) / 12;
+  }
+
+  // Bayes: posterior ∝ verosimilitud · previa; z <= 0 (sin eco) no se aplica
+  void update(const float z[MeasDim], const float sigma[MeasDim]) {
+    BayesLikelihood l[MeasDim];
+    int16_t ref, first, last;
+    if (!prepare(z, sigma, l, ref, first, last)) return;
+    // Posterior y sus momentos en una pasada (d: bins desde ref)
+    const float prior = norm;  // copia local: belief[i] no puede pisarla
+    float total = 0, sum1 = 0, sum2 = 0;
+    BAYES_SIMD_SUMS
+    for (int i = first; i <= last; i++) {
+      float b = belief[i] * prior;  // primero norm: norm · 65535² desbordaría
+      for (uint8_t m = 0; m < MeasDim; m++) b *= bayes_lookup(l[m], i);
+      float d = i - ref;
+      float db = d * b;
+      belief[i] = b;
+      total += b;
+      sum1 += db;
+      sum2 += d * db;
+    }
+    finish(first, last, ref, total, sum1, sum2);
+  }
+
+  // Paso de movimiento: núcleo binomial de radio R bins (σ = √(R/2) bins)
+  template <uint8_t R>
+  void predict() {
+    typedef BayesMotionKernel<R> K;
+    bayes_slide<R>(belief, lo, hi, NumBins, 0.0f, [](const float *win) {
+      float s = 0;
+      for (uint8_t k = 0; k <= 2 * R; k++) s += pgm_read_word(&K::data[k]) * win[k];
+      return s * (1.0f / (1UL << (2 * R)));
+    });
+    spread(R);
+  }
+
+  // Media de la creencia (cm), calculada en update()
+  float expected() const { return mean; }
+
+  // Varianza de la creencia (cm²)
+  float variance() const { return var; }
+
+  // — Ventana móvil (rejilla fina de BayesTwoLevelGrid) —
+  // Distancia del bin 0
+  float origin() const { return minDist; }
+
+  // Ancho de un bin (cm)
+  float spacing() const { return step; }
+
+  // Mueve la ventana a minDist0 y empieza uniforme
+  void place(float minDist0) {
+    minDist = minDist0;
+    init();
+  }
+
+  // Desplaza la ventana bins enteros conservando la creencia; lo que entra
+  // por el extremo nuevo empieza en 0 (lejos de la media: ya era ~0)
+  void shift(int16_t bins) {
+    if (bins > hi || bins < lo - (int16_t)(NumBins - 1)) {  // todo sale
+      minDist += bins * step;
+      init();
+      return;
+    }
+    if (bins > 0) {
+      for (int16_t i = 0; i + bins < NumBins; i++) belief[i] = belief[i + bins];
+      for (int16_t i = NumBins - bins; i < NumBins; i++) belief[i] = 0;
+    } else if (bins < 0) {
+      for (int16_t i = NumBins - 1; i + bins >= 0; i--) belief[i] = belief[i + bins];
+      for (int16_t i = 0; i < -bins; i++) belief[i] = 0;
+    }
+    minDist += bins * step;
+    if (Sparse) {
+      lo = (lo - bins > 0) ? lo - bins : 0;
+      hi = (hi - bins < NumBins - 1) ? hi - bins : NumBins - 1;
+    }
+  }
+
+protected:
+  // Verosimilitud de cada medición (z <= 0: sin eco) y bounds()
+  bool prepare(const float z[MeasDim], const float sigma[MeasDim], BayesLikelihood l[MeasDim], int16_t &ref,
+               int16_t &first, int16_t &last) const {
+    for (uint8_t m = 0; m < MeasDim; m++) {
+      l[m] = (z[m] > 0) ? bayes_likelihood(z[m], sigma[m], minDist, step) : bayes_likelihood_none();
+    }
+    return bounds(z, l, ref, first, last);
+  }
+
+  // Bin de referencia de los momentos (la primera lectura) y bins a
+  // recorrer: el rango activo recortado al soporte de cada medición.
+  // false si no hay ninguna lectura
+  bool bounds(const float z[MeasDim], const BayesLikelihood l[MeasDim], int16_t &ref, int16_t &first,
+              int16_t &last) const {
+    uint8_t valid = 0;
+    ref = 0;
+    for (uint8_t m = 0; m < MeasDim; m++) {
+      if (z[m] > 0 && valid++ == 0) ref = l[m].center;
+    }
+    first = lo;
+    last = hi;
+    if (Sparse) {
+      for (uint8_t m = 0; m < MeasDim; m++) {
+        if (l[m].center - l[m].reach > first) first = l[m].center - l[m].reach;
+        if (l[m].center + l[m].reach < last) last = l[m].center + l[m].reach;
+      }
+    }
+    return valid > 0;
+  }
+
+  // El paso de movimiento de radio R suma R/2 bins² a la varianza
+  void spread(uint8_t R) { var += R * step * step / 2; }
+
+  // Tras la pasada por belief[first..last]: norm, media y varianza
+  void finish(int16_t first, int16_t last, int16_t ref, float total, float sum1, float sum2) {
+    // Si todo cayó a cero (o a desnormales, donde 1 / total desborda a
+    // infinito), reiniciar; si no, norm queda para el ciclo siguiente
+    if (total > BAYES_MIN_TOTAL) {
+      // Lo que sale del rango queda en 0 y los bordes por debajo de
+      // BAYES_TAIL_CUT · total se anulan: con la tabla hasta 13σ las colas
+      // no llegan a 0 y se hunden en desnormales (lentísimos en el PC).
+      // Con Sparse además se recortan; si no, el rango sigue entero
+      for (int16_t i = lo; i < first; i++) belief[i] = 0;
+      for (int16_t i = last + 1; i <= hi; i++) belief[i] = 0;
+      const float cut = total * BAYES_TAIL_CUT;
+      while (belief[first] <= cut) belief[first++] = 0;
+      while (belief[last] <= cut) belief[last--] = 0;
+      if (Sparse) {
+        lo = first;
+        hi = last;
+      }
+      norm = 1 / total;
+      float m1 = sum1 * norm;
+      mean = minDist + (ref + m1) * step;
+      var = (sum2 * norm - m1 * m1) * step * step;
+    } else {
+      init();
+      resets++;
+    }
+  }
+
+private:
+  float minDist;
+  float step;
+  float mean;
+  float var;
+};
+
+// — Rejilla de dos niveles —
+// Una rejilla gruesa (CoarseBins de coarseStep) cubre todo el alcance del
+// sensor y una fina (FineBins de fineStep) sigue al objeto: memoria y coste
+// de CoarseBins + FineBins bins en lugar de los (alcance / fineStep) de una
+// rejilla plana con la misma resolución. La gruesa usa σ de al menos un bin
+// (no resuelve menos). Si su estimación sale de la ventana fina, la ventana
+// se recoloca centrada en ella y empieza uniforme; si es la media fina la
+// que se acerca al borde (a menos de un cuarto de ventana), la ventana se
+// desplaza bins enteros y conserva su creencia. La estimación es la fina.
+template <uint16_t CoarseBins, uint16_t FineBins, uint8_t MeasDim>
+class BayesTwoLevelGrid {
+public:
+  BayesGrid<CoarseBins, MeasDim, true> coarse;
+  BayesGrid<FineBins, MeasDim, true> fine;
+
+  BayesTwoLevelGrid(float minDist0, float coarseStep0, float fineStep0)
+      : coarse(minDist0, coarseStep0), fine(minDist0, fineStep0),
+        minDist(minDist0), coarseStep(coarseStep0), fineStep(fineStep0) {}
+
+  void init() {
+    coarse.init();
+    fine.place(minDist);
+  }
+
+  // Paso de movimiento: R bins finos; la gruesa con el mínimo (R = 1)
+  template <uint8_t R>
+  void predict() {
+    coarse.template predict<1>();
+    fine.template predict<R>();
+  }
+
+  void update(const float z[MeasDim], const float sigma[MeasDim]) {
+    float sigmaCoarse[MeasDim];
+    for (uint8_t m = 0; m < MeasDim; m++) sigmaCoarse[m] = (sigma[m] > coarseStep) ? sigma[m] : coarseStep;
+    coarse.update(z, sigmaCoarse);
+    // Ventana fina [a, b] dentro del alcance de la gruesa
+    const float span = (FineBins - 1) * fineStep;
+    const float top = minDist + (CoarseBins - 1) * coarseStep - span;
+    float a = fine.origin(), b = a + span;
+    float c = coarse.expected();
+    if (c < a || c > b) {
+      float start = c - span / 2;
+      fine.place(start < minDist ? minDist : (start > top ? top : start));
+    } else {
+      float f = fine.expected();
+      if (f < a + span / 4 || f > b - span / 4) {
+        int16_t bins = (int16_t)((f - (a + b) / 2) / fineStep);
+        if (a + bins * fineStep < minDist) bins = (int16_t)((minDist - a) / fineStep);
+        if (a + bins * fineStep > top) bins = (int16_t)((top - a) / fineStep);
+        fine.shift(bins);
+      }
+    }
+    fine.update(z, sigma);
+  }
+
+  float expected() const { return fine.expected(); }
+  float variance() const { return fine.variance(); }
+
+private:
+  float minDist;
+  float coarseStep;
+  float fineStep;
+};
+
+// — Creencia entera —
+// uint16_t relativa al máximo (Q16, 65535 ≈ máximo) en lugar de float:
+// 2 bytes por bin en vez de 4. Las mediciones se funden antes de la pasada:
+// el producto de gaussianas es otra gaussiana en la media ponderada por
+// 1/σ², con 1/σ² = Σ 1/σᵢ², por un factor exp(-(z₁ - z₂)²/(2(σ₁² + σ₂²)))
+// igual en todos los bins que se va al normalizar. Sin él, dos sensores que
+// discrepan más de 9.5σ ya no anulan la creencia (la tabla Q16 llega a
+// 4.75σ) y una sola consulta de tabla por bin basta. Cada bin multiplica
+// por su entrada Q16 y desplaza 16 bits; lo que cae por debajo de 1 queda
+// en 0, como la cola de la tabla, y el rango activo se recorta igual que
+// en BayesGrid. Solo se reinicia si la creencia previa y la medición
+// fundida no se solapan (un salto real).
+// Normalización diferida: el ciclo siguiente desplaza cada bin a la
+// izquierda tantos bits como ceros iniciales tenga el máximo de este
+// (bayes_clz16), que así vuelve a la parte alta de los 16 bits antes del
+// producto. La media sale de sumas enteras Σb y Σ(i - ref)·b, con una
+// sola división en flotante por ciclo.
+// Coste: en el PC la densa es un 25-30 % más lenta que BayesGrid
+// (banco_bayes.cpp, 281 bins: ~1450 frente a ~1150 ns/ciclo), porque allí
+// el float es hardware; la dispersa va a la par o más rápida. En el AVR
+// el float es software y la entera evita sus multiplicaciones, pero sus
+// ciclos no se han medido en la placa.
+
+// Ceros iniciales de v en 16 bits (v > 0); unsigned es de 16 bits en el
+// AVR y de 32 en el PC
+inline uint8_t bayes_clz16(uint16_t v) {
+  return __builtin_clz(v) - (8 * sizeof(unsigned) - 16);
+}
+
+// Bits que se quitan a los pesos para que Σ|i - ref|·b quepa en int32_t
+constexpr uint8_t bayes_moment_shift(uint32_t bins, uint8_t s) {
+  return ((uint64_t)bins * (bins - 1) / 2 * (65535u >> s) < 0x80000000ULL) ? s : bayes_moment_shift(bins, s + 1);
+}
+
+template <uint16_t NumBins, uint8_t MeasDim, bool Sparse = false>
+class BayesIntGrid {
+public:
+  uint16_t belief[NumBins];  // Q16 relativa al máximo (· 2^shift)
+  uint8_t shift;             // ceros iniciales del máximo anterior
+  int16_t lo, hi;            // rango activo (inclusive)
+  uint32_t resets = 0;       // reinicios por creencia nula (diagnóstico)
+
+  BayesIntGrid(float minDist0, float step0) : minDist(minDist0), step(step0) { init(); }
+
+  // Distribución uniforme
+  void init() {
+    for (uint16_t i = 0; i < NumBins; i++) belief[i] = 65535;
+    shift = 0;
+    lo = 0;
+    hi = NumBins - 1;
+    mean = minDist + (NumBins - 1) * step / 2;
+  }
+
+  // Bayes con enteros; z <= 0 (sin eco) no se aplica
+  void update(const float z[MeasDim], const float sigma[MeasDim]) {
+    // Medición fundida: media ponderada por 1/σ²
+    float precision = 0, weighted = 0;
+    for (uint8_t m = 0; m < MeasDim; m++) {
+      if (z[m] > 0) {
+        float w = 1 / (sigma[m] * sigma[m]);
+        precision += w;
+        weighted += w * z[m];
+      }
+    }
+    if (precision == 0) return;
+    BayesLikelihood l = bayes_likelihood(weighted / precision, 1 / sqrtf(precision), minDist, step);
+    int16_t ref = l.center;
+    if (ref < 0) ref = 0;  // |i - ref| < NumBins para bayes_moment_shift
+    if (ref > NumBins - 1) ref = NumBins - 1;
+    int16_t first = lo, last = hi;
+    if (Sparse) {
+      if (l.center - l.reachQ16 > first) first = l.center - l.reachQ16;
+      if (l.center + l.reachQ16 < last) last = l.center + l.reachQ16;
+    }
+    // Posterior, máximo y momentos en una pasada
+    const uint8_t momentShift = bayes_moment_shift(NumBins, 0);
+    uint16_t peak = 0;
+    uint32_t total = 0;
+    int32_t sum1 = 0;
+    for (int i = first; i <= last; i++) {
+      // belief[i] <= máximo anterior: el desplazamiento cabe en 16 bits
+      uint16_t b = ((uint32_t)(uint16_t)(belief[i] << shift) * bayes_lookup_q16(l, i)) >> 16;
+      belief[i] = b;
+      if (b > peak) peak = b;
+      uint16_t w = b >> momentShift;
+      total += w;
+      sum1 += (int32_t)(i - ref) * w;
+    }
+    if (peak == 0) {
+      init();
+      resets++;
+      return;
+    }
+    if (Sparse) {
+      for (int16_t i = lo; i < first; i++) belief[i] = 0;
+      for (int16_t i = last + 1; i <= hi; i++) belief[i] = 0;
+      while (belief[first] == 0) first++;
+      while (belief[last] == 0) last--;
+      lo = first;
+      hi = last;
+    }
+    shift = bayes_clz16(peak);
+    if (total > 0) mean = minDist + (ref + (float)sum1 / total) * step;
+  }
+
+  // Paso de movimiento: el núcleo binomial con enteros y un desplazamiento
+  template <uint8_t R>
+  void predict() {
+    static_assert(R <= 7, "4^R · 65535 debe caber en uint32_t");
+    typedef BayesMotionKernel<R> K;
+    bayes_slide<R>(belief, lo, hi, NumBins, (uint16_t)0, [](const uint16_t *win) {
+      uint32_t s = 0;
+      for (uint8_t k = 0; k <= 2 * R; k++) s += (uint32_t)pgm_read_word(&K::data[k]) * win[k];
+      return (uint16_t)((s + (1UL << (2 * R - 1))) >> (2 * R));
+    });
+  }
+
+  // Media de la creencia (cm), calculada en update()
+  float expected() const { return mean; }
+
+private:
+  float minDist;
+  float step;
+  float mean;
+};
+
+// — Creencia en el dominio logarítmico —
+// log2 de la creencia en Q4 (1/16 de bit) sobre int16_t. La
+// log-verosimilitud de una medición es d² · k con k = STEP² / (2 ln2 σ²)
+// en Q4 por bin²: un producto entero por bin y sensor, sin tabla. Cada
+// actualización resta además el máximo del ciclo anterior (peak) en la
+// misma pasada: la normalización es ese desplazamiento y la creencia queda
+// relativa a su máximo. Un suelo de BAYES_LOG_FLOOR bits bajo el máximo
+// sustituye a los ceros: un bin lejano vuelve a crecer si el objeto llega
+// a él, así que no hay subdesbordamiento ni init() que borre la historia.
+#define BAYES_LOG_ONE 16                        // Q4: un bit
+#define BAYES_LOG_FLOOR (24 * BAYES_LOG_ONE)    // 2^-24 bajo el máximo
+
+// 2^(-f/16) en Q16: parte fraccionaria de un log2 en Q4
+constexpr uint16_t bayes_exp2_entry(uint16_t f) {
+  return bayes_lut_round(65535.0 / bayes_exp(f * 0.6931471805599453 / BAYES_LOG_ONE));
+}
+
+template <typename L>
+struct BayesExp2Table;
+
+template <uint16_t... I>
+struct BayesExp2Table<KalmanIndexList<I...> > {
+  static const uint16_t data[sizeof...(I)];
+};
+
+template <uint16_t... I>
+const uint16_t BayesExp2Table<KalmanIndexList<I...> >::data[sizeof...(I)] PROGMEM = {
+  bayes_exp2_entry(I)...
+};
+
+typedef BayesExp2Table<KalmanMakeIndex<BAYES_LOG_ONE>::type> BayesExp2Lut;
+
+// Peso lineal en Q16 de un bin e unidades Q4 bajo el máximo. Desde 16 bits
+// es 0: así el desplazamiento no pasa de 15 (int es de 16 bits en el AVR)
+inline uint16_t bayes_exp2_weight(uint16_t e) {
+  if (e >= 16 * BAYES_LOG_ONE) return 0;
+  return pgm_read_word(&BayesExp2Lut::data[e & (BAYES_LOG_ONE - 1)]) >> (e / BAYES_LOG_ONE);
+}
+
+// Núcleo de movimiento en log2 Q4: la gaussiana de varianza R/2 bins² del
+// binomial, 16 · (k - R)² / (R ln2). En el dominio logarítmico la suma de
+// la convolución se aproxima por su término mayor (máximo, no suma)
+constexpr int16_t bayes_log_motion_entry(uint8_t r, uint16_t k) {
+  return (int16_t)(BAYES_LOG_ONE * ((double)k - r) * ((double)k - r) / (r * 0.6931471805599453) + 0.5);
+}
+
+template <uint8_t R, typename L>
+struct BayesLogMotionTable;
+
+template <uint8_t R, uint16_t... I>
+struct BayesLogMotionTable<R, KalmanIndexList<I...> > {
+  static const int16_t data[sizeof...(I)];
+};
+
+template <uint8_t R, uint16_t... I>
+const int16_t BayesLogMotionTable<R, KalmanIndexList<I...> >::data[sizeof...(I)] PROGMEM = {
+  bayes_log_motion_entry(R, I)...
+};
+
+template <uint8_t R>
+struct BayesLogMotionKernel : BayesLogMotionTable<R, typename KalmanMakeIndex<2 * R + 1>::type> {};
+
+// Una medición preparada para el ciclo en el dominio logarítmico
+struct BayesLogLikelihood {
+  int16_t center;  // bin más cercano a z
+  uint32_t k;      // Q16: log2 en Q4 por bin² de distancia
+  int16_t reach;   // desde aquí la log-verosimilitud es el suelo
+};
+
+// Única aritmética flotante por sensor y ciclo (una raíz)
+inline BayesLogLikelihood bayes_log_likelihood(float z, float sigma, float minDist, float step) {
+  BayesLogLikelihood l;
+  l.center = (int16_t)((z - minDist) / step + 0.5f);
+  float k = BAYES_LOG_ONE * step * step / (2 * 0.6931472f * sigma * sigma);
+  l.k = (uint32_t)(k * 65536 + 0.5f);
+  if (l.k == 0) l.k = 1;
+  l.reach = (int16_t)sqrtf((float)((uint32_t)BAYES_LOG_FLOOR << 16) / l.k);
+  return l;
+}
+
+// -log2 de la verosimilitud del bin i en Q4, saturada al suelo
+inline int16_t bayes_log_lookup(const BayesLogLikelihood &l, int16_t i) {
+  uint16_t d = (i > l.center) ? i - l.center : l.center - i;
+  if (d > l.reach) return BAYES_LOG_FLOOR;
+  return ((uint32_t)d * d * l.k + 0x8000) >> 16;  // d² · k <= suelo << 16
+}
+
+template <uint16_t NumBins, uint8_t MeasDim>
+class BayesLogGrid {
+public:
+  int16_t belief[NumBins];  // log2 Q4, relativo a peak
+  int16_t peak;             // máximo de belief tras la última actualización
+
+  BayesLogGrid(float minDist0, float step0) : minDist(minDist0), step(step0) { init(); }
+
+  // Distribución uniforme: log2 igual en todos los bins
+  void init() {
+    for (uint16_t i = 0; i < NumBins; i++) belief[i] = 0;
+    peak = 0;
+  }
+
+  // Una pasada: normalizar (restar peak), suelo y sumar log-verosimilitudes
+  void update(const float z[MeasDim], const float sigma[MeasDim]) {
+    BayesLogLikelihood l[MeasDim];
+    uint8_t valid = 0;
+    for (uint8_t m = 0; m < MeasDim; m++) {
+      if (z[m] > 0) l[valid++] = bayes_log_likelihood(z[m], sigma[m], minDist, step);
+    }
+    if (valid == 0) return;
+    int16_t newPeak = -32768;
+    for (uint16_t i = 0; i < NumBins; i++) {
+      int16_t s = belief[i] - peak;
+      if (s < -BAYES_LOG_FLOOR) s = -BAYES_LOG_FLOOR;
+      for (uint8_t m = 0; m < valid; m++) s -= bayes_log_lookup(l[m], i);
+      belief[i] = s;
+      if (s > newPeak) newPeak = s;
+    }
+    peak = newPeak;
+  }
+
+  // Paso de movimiento (máximo en lugar de suma); peak no cambia porque
+  // el término central del núcleo es 0
+  template <uint8_t R>
+  void predict() {
+    typedef BayesLogMotionKernel<R> K;
+    int16_t lo = 0, hi = NumBins - 1;
+    bayes_slide<R>(belief, lo, hi, NumBins, (int16_t)-0x4000, [](const int16_t *win) {
+      int16_t s = -0x4000;
+      for (uint8_t k = 0; k <= 2 * R; k++) {
+        int16_t v = win[k] - (int16_t)pgm_read_word(&K::data[k]);
+        if (v > s) s = v;
+      }
+      return s;
+    });
+  }
+
+  // Media de la creencia (cm): pesos 2^(belief - peak) por tabla y desplazamiento
+  float expected() const {
+    float sum = 0;
+    float weight_sum = 0;
+    for (uint16_t i = 0; i < NumBins; i++) {
+      uint16_t w = bayes_exp2_weight(peak - belief[i]);
+      if (w == 0) continue;
+      float x = minDist + i * step;
+      sum += x * w;
+      weight_sum += w;
+    }
+    return sum / weight_sum;  // el bin de peak pesa 65535
+  }
+
+private:
+  float minDist;
+  float step;
+};
+
+#endif
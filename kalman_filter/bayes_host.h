@@ -0,0 +1,355 @@
+// ============================================================
+//  FILTRO DE REJILLA EN EL PC: PASADAS AVX2 CON ALTERNATIVA GENÉRICA
+//  Solo para herramientas de PC (repeticion_bayes.cpp, banco_repeticion.cpp),
+//  nunca en un sketch. BayesHostGrid<NumBins, MeasDim, Sparse> es la
+//  BayesGrid de bayes_grid.h (mismos prepare/finish, mismo estado) con la
+//  pasada de actualización (verosimilitud, posterior, total, media y
+//  varianza) y la convolución de predict<R>() en un backend elegido al
+//  arrancar según la CPU:
+//    avx2     8 bins por instrucción (AVX2 y FMA); la verosimilitud sale
+//             de la misma tabla float que en el AVR con un gather
+//    generico BayesGrid tal cual (update() y predict<R>() de la base)
+//  BAYES_HOST_BACKEND=generico|avx2 en el entorno fuerza uno (para medir).
+//  Las funciones AVX2 llevan target("avx2,fma"): el binario no necesita
+//  -mavx2 ni -march=native y sigue arrancando en CPUs sin AVX2.
+//  El resultado es el de BayesGrid salvo el orden y el redondeo de las
+//  sumas (el genérico, idéntico). Sin libm por bin en ninguno.
+// ============================================================
+
+#ifndef BAYES_HOST_H
+#define BAYES_HOST_H
+
+#include <stdlib.h>
+#include <string.h>
+
+// Las sumas de la pasada de BayesGrid (el backend genérico) pueden
+// reordenarse si el compilador entiende omp simd (ver bayes_grid.h)
+#if defined(_OPENMP) && !defined(BAYES_HOST_SIMD)
+#define BAYES_HOST_SIMD
+#endif
+#include "bayes_grid.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BAYES_HOST_X86
+#endif
+
+#define BAYES_HOST_MAX_MEAS 8    // sensores por actualización
+#define BAYES_HOST_MAX_RADIUS 8  // radio máximo de predict<R>() (C(2R, R) cabe en uint16_t)
+#define BAYES_HOST_SLACK 7       // lectura de más del último bloque de 8
+
+// — Una pasada de actualización: posterior de belief[first..last] —
+// Con taps > 0 la previa del bin i no es belief[i] sino la predicción
+// Σ_t w[t] · window[i - first + t] (predict<R>() diferido a esta pasada)
+struct BayesHostPass {
+  float *belief;
+  int first, last;
+  float prior;  // norm del ciclo anterior
+  const BayesLikelihood *l;
+  uint8_t measDim;
+  int ref;      // bin de referencia de los momentos
+  const float *window;
+  const float *w;
+  uint8_t taps;
+};
+
+// — Backend —
+// pass: la pasada y sus momentos en sums (total, Σd·b, Σd²·b con
+//       d = i - ref), como el bucle de BayesGrid
+// convolve: out[j] = Σ_t w[t] · in[j + t] para j < n, t < taps (la
+//       predicción sola, cuando no llega a haber actualización)
+// window e in deben tener BAYES_HOST_SLACK valores legibles de más.
+// Sin pass (el genérico) BayesHostGrid es BayesGrid tal cual: la predicción
+// diferida solo compensa con una pasada que la vectorice
+struct BayesHostBackend {
+  const char *name;
+  void (*pass)(const BayesHostPass &p, float sums[3]);
+  void (*convolve)(const float *in, float *out, int n, const float *w, uint8_t taps);
+};
+
+#ifdef BAYES_HOST_X86
+#define BAYES_HOST_AVX2 __attribute__((target("avx2,fma")))
+
+// Suma de los 8 carriles
+BAYES_HOST_AVX2 inline float bayes_host_hsum(__m256 v) {
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+// Convolución de 8 bins seguidos: el núcleo es simétrico (w[t] = w[taps-1-t],
+// taps impar), así que cada par de extremos va en una suma y un FMA
+BAYES_HOST_AVX2 inline __m256 bayes_host_conv8(const float *in, const float *w, uint8_t taps) {
+  uint8_t r = taps / 2;
+  __m256 s = _mm256_mul_ps(_mm256_set1_ps(w[r]), _mm256_loadu_ps(in + r));
+  for (uint8_t t = 0; t < r; t++) {
+    __m256 pair = _mm256_add_ps(_mm256_loadu_ps(in + t), _mm256_loadu_ps(in + taps - 1 - t));
+    s = _mm256_fmadd_ps(_mm256_set1_ps(w[t]), pair, s);
+  }
+  return s;
+}
+
+// bayes_lookup() de 8 bins: |i - center| · scale en 32 bits (desborda
+// igual que el escalar), índice saturado al 0 final y gather de la tabla.
+// El último bloque, incompleto, va con máscara: sin cola escalar
+BAYES_HOST_AVX2 inline void bayes_host_pass_avx2(const BayesHostPass &p, float sums[3]) {
+  const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i half = _mm256_set1_epi32(0x8000);
+  const __m256i edge = _mm256_set1_epi32(BAYES_LUT_SIZE);
+  const float *lut = BayesLikelihoodLut::data;
+  const __m256 prior = _mm256_set1_ps(p.prior);
+  __m256 total = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps(), sum2 = _mm256_setzero_ps();
+  __m256i center[BAYES_HOST_MAX_MEAS], scale[BAYES_HOST_MAX_MEAS];
+  for (uint8_t m = 0; m < p.measDim; m++) {
+    center[m] = _mm256_set1_epi32(p.l[m].center);
+    scale[m] = _mm256_set1_epi32((int)p.l[m].scale);
+  }
+  __m256i iv = _mm256_add_epi32(_mm256_set1_epi32(p.first), lane);
+  const __m256i ref = _mm256_set1_epi32(p.ref), eight = _mm256_set1_epi32(8);
+  const __m256i end = _mm256_set1_epi32(p.last + 1);
+  for (int i = p.first; i <= p.last; i += 8) {
+    __m256i live = _mm256_cmpgt_epi32(end, iv);
+    __m256 b;
+    if (p.taps) {
+      b = _mm256_and_ps(bayes_host_conv8(p.window + (i - p.first), p.w, p.taps), _mm256_castsi256_ps(live));
+    } else {
+      b = _mm256_maskload_ps(p.belief + i, live);
+    }
+    b = _mm256_mul_ps(b, prior);
+    for (uint8_t m = 0; m < p.measDim; m++) {
+      __m256i d = _mm256_abs_epi32(_mm256_sub_epi32(iv, center[m]));
+      __m256i idx = _mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(d, scale[m]), half), 16);
+      idx = _mm256_min_epu32(idx, edge);
+      b = _mm256_mul_ps(b, _mm256_i32gather_ps(lut, idx, 4));
+    }
+    __m256 d = _mm256_cvtepi32_ps(_mm256_sub_epi32(iv, ref));
+    __m256 db = _mm256_mul_ps(d, b);
+    _mm256_maskstore_ps(p.belief + i, live, b);
+    total = _mm256_add_ps(total, b);
+    sum1 = _mm256_add_ps(sum1, db);
+    sum2 = _mm256_fmadd_ps(d, db, sum2);
+    iv = _mm256_add_epi32(iv, eight);
+  }
+  sums[0] = bayes_host_hsum(total);
+  sums[1] = bayes_host_hsum(sum1);
+  sums[2] = bayes_host_hsum(sum2);
+}
+
+BAYES_HOST_AVX2 inline void bayes_host_convolve_avx2(const float *in, float *out, int n, const float *w,
+                                                    uint8_t taps) {
+  const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  for (int j = 0; j < n; j += 8) {
+    __m256 s = bayes_host_conv8(in + j, w, taps);
+    if (j + 8 <= n) _mm256_storeu_ps(out + j, s);
+    else _mm256_maskstore_ps(out + j, _mm256_cmpgt_epi32(_mm256_set1_epi32(n - j), lane), s);
+  }
+}
+#endif
+
+const BayesHostBackend bayes_host_generic = {"generico", 0, 0};
+#ifdef BAYES_HOST_X86
+const BayesHostBackend bayes_host_avx2 = {"avx2", bayes_host_pass_avx2, bayes_host_convolve_avx2};
+#endif
+
+// ¿Puede esta CPU usar el backend b?
+inline bool bayes_host_supported(const BayesHostBackend &b) {
+#ifdef BAYES_HOST_X86
+  if (&b == &bayes_host_avx2) return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+  return &b == &bayes_host_generic;
+}
+
+// Backend por nombre ("generico", "avx2"); 0 si no existe o la CPU no lo admite
+inline const BayesHostBackend *bayes_host_find(const char *name) {
+  const BayesHostBackend *all[] = {
+#ifdef BAYES_HOST_X86
+    &bayes_host_avx2,
+#endif
+    &bayes_host_generic,
+  };
+  for (const BayesHostBackend *b : all) {
+    if (strcmp(b->name, name) == 0) return bayes_host_supported(*b) ? b : 0;
+  }
+  return 0;
+}
+
+// El mejor backend de esta CPU, o el de BAYES_HOST_BACKEND; se decide una vez
+inline const BayesHostBackend &bayes_host_backend() {
+  static const BayesHostBackend *chosen = [] {
+    const char *forced = getenv("BAYES_HOST_BACKEND");
+    const BayesHostBackend *b = forced ? bayes_host_find(forced) : 0;
+#ifdef BAYES_HOST_X86
+    if (!b && bayes_host_supported(bayes_host_avx2)) b = &bayes_host_avx2;
+#endif
+    return b ? b : &bayes_host_generic;
+  }();
+  return *chosen;
+}
+
+// Núcleo binomial de predict<R>() en float: C(2R, k) / 4^R
+template <uint8_t R>
+struct BayesHostKernel {
+  float w[2 * R + 1];
+
+  BayesHostKernel() {
+    for (uint8_t k = 0; k <= 2 * R; k++) {
+      w[k] = pgm_read_word(&BayesMotionKernel<R>::data[k]) * (1.0f / (1UL << (2 * R)));
+    }
+  }
+};
+
+// — BayesGrid con las pasadas del backend —
+template <uint16_t NumBins, uint8_t MeasDim, bool Sparse = false>
+class BayesHostGrid : public BayesGrid<NumBins, MeasDim, Sparse> {
+  typedef BayesGrid<NumBins, MeasDim, Sparse> Base;
+  static_assert(MeasDim <= BAYES_HOST_MAX_MEAS, "subir BAYES_HOST_MAX_MEAS");
+public:
+  BayesHostGrid(float minDist0, float step0, const BayesHostBackend &backend0 = bayes_host_backend())
+      : Base(minDist0, step0), backend(&backend0), winFirst(0), w(0) {}
+
+  const BayesHostBackend &which() const { return *backend; }
+
+  void init() {
+    taps = 0;
+    Base::init();
+  }
+
+  void place(float minDist0) {
+    taps = 0;
+    Base::place(minDist0);
+  }
+
+  void shift(int16_t bins) {
+    flush();
+    Base::shift(bins);
+  }
+
+  void update(const float z[MeasDim], const float sigma[MeasDim]) {
+    if (!backend->pass) {
+      Base::update(z, sigma);
+      return;
+    }
+    BayesLikelihood l[MeasDim];
+    int16_t ref, first, last;
+    for (uint8_t m = 0; m < MeasDim; m++) l[m] = likelihood(m, z[m], sigma[m]);
+    if (!this->bounds(z, l, ref, first, last)) {
+      flush();
+      return;
+    }
+    float sums[3] = {0, 0, 0};
+    if (first <= last) {
+      BayesHostPass p = {this->belief, first, last, this->norm, l, MeasDim, ref, window + (first - winFirst), w, taps};
+      backend->pass(p, sums);
+    }
+    // Lo que la pasada no recorre finish() lo deja en 0: predicción consumida
+    taps = 0;
+    this->finish(first, last, ref, sums[0], sums[1], sums[2]);
+  }
+
+  // Predicción diferida, como la normalización: aquí solo se copia el
+  // rango activo a una ventana con R ceros a cada lado (en el PC sobra
+  // memoria) y se ensancha el rango; la convolución se hace en la pasada
+  // de update(), solo en los bins que esta recorre
+  template <uint8_t R>
+  void predict() {
+    static_assert(R <= BAYES_HOST_MAX_RADIUS, "subir BAYES_HOST_MAX_RADIUS");
+    if (!backend->pass) {
+      Base::template predict<R>();
+      return;
+    }
+    static const BayesHostKernel<R> kernel;
+    flush();
+    int16_t &lo = this->lo, &hi = this->hi;
+    int16_t first = (lo - R > 0) ? lo - R : 0;
+    int16_t last = (hi + R < NumBins - 1) ? hi + R : NumBins - 1;
+    int16_t head = (lo - first) + R, body = hi - lo + 1;
+    int16_t tail = (last - first + 1) + 2 * R + BAYES_HOST_SLACK - head - body;
+    memset(window, 0, head * sizeof(float));
+    memcpy(window + head, this->belief + lo, body * sizeof(float));
+    memset(window + head + body, 0, tail * sizeof(float));
+    lo = first;
+    hi = last;
+    winFirst = first;
+    w = kernel.w;
+    taps = 2 * R + 1;
+    this->spread(R);
+  }
+
+  // Aplica la predicción pendiente a belief (sin actualización detrás)
+  void flush() {
+    if (!taps) return;
+    backend->convolve(window, this->belief + winFirst, this->hi - winFirst + 1, w, taps);
+    taps = 0;
+  }
+
+private:
+  // bayes_likelihood() con scale y reach guardados por sensor: solo
+  // cambian con σ (adaptive_noise la deja quieta en su mínimo), así que
+  // lo habitual es una división por lectura en lugar de tres
+  BayesLikelihood likelihood(uint8_t m, float z, float sigma) {
+    if (z <= 0) return bayes_likelihood_none();
+    if (sigma != shapeSigma[m]) {
+      shape[m] = bayes_likelihood(z, sigma, this->origin(), this->spacing());
+      shapeSigma[m] = sigma;
+    }
+    BayesLikelihood l = shape[m];
+    l.center = bayes_bin(z, this->origin(), this->spacing());
+    return l;
+  }
+
+  const BayesHostBackend *backend;
+  BayesLikelihood shape[MeasDim];
+  float shapeSigma[MeasDim] = {};  // 0: ninguna guardada
+  float window[NumBins + 2 * BAYES_HOST_MAX_RADIUS + BAYES_HOST_SLACK];
+  int16_t winFirst;    // bin de window[R]; sin predicción, window no se lee
+  const float *w;      // núcleo de la predicción pendiente
+  uint8_t taps = 0;    // 0: ninguna pendiente
+};
+
+// — Un ciclo de carrito.cpp: adaptive_noise(), update_belief() y
+// expected_value() tal cual, con BAYES_PREDICT —
+// Las constantes 1.1 y 0.9 van en float: en el AVR double es float, y en
+// double la σ se separaría de la del sketch en el último bit
+template <typename Grid, uint8_t MotionRadius>
+struct BayesHostCarrito {
+  Grid grid;
+  float minDist, rangeMax;
+  float sigma1 = 0.4f, sigma2 = 0.4f;
+
+  // extra: el backend de BayesHostGrid, si se quiere uno concreto
+  template <typename... Extra>
+  BayesHostCarrito(float minDist0, float rangeMax0, float step0, const Extra &...extra)
+      : grid(minDist0, step0, extra...), minDist(minDist0), rangeMax(rangeMax0) {}
+
+  void init() {
+    grid.init();
+    sigma1 = sigma2 = 0.4f;
+  }
+
+  // Lecturas de read_distance() (-1 sin eco); devuelve la estimación
+  float cycle(float z1, float z2) {
+    adaptive_noise(z1, z2);
+    if (z1 >= 0 && z2 >= 0) {
+      grid.template predict<MotionRadius>();
+      const float z[2] = {z1, z2};
+      const float sigma[2] = {sigma1, sigma2};
+      grid.update(z, sigma);
+    }
+    return grid.expected();
+  }
+
+  static float constrain(float x, float a, float b) { return (x < a) ? a : ((x > b) ? b : x); }
+
+  void adaptive_noise(float z1, float z2) {
+    if ((z1 == minDist && z2 == rangeMax) || (z2 == minDist && z1 == rangeMax)) {
+      sigma1 = constrain(sigma1 * 1.1f, 0.2f, 1.0f);
+      sigma2 = constrain(sigma2 * 1.1f, 0.2f, 1.0f);
+    } else {
+      sigma1 = constrain(sigma1 * 0.9f, 0.2f, 1.0f);
+      sigma2 = constrain(sigma2 * 0.9f, 0.2f, 1.0f);
+    }
+  }
+};
+
+#endif
@@ -3,19 +3,81 @@
 #define TRIG2 3
 #define ECHO2 4
 
+#include "bayes_grid.h"
+#include "filtro_particulas.h"
+
 // Constantes para detección
 const float MIN_DIST = 2.0;
 const float MAX_DIST = 30.0;
 const float STEP = 0.1;
 const int NUM_BINS = (MAX_DIST - MIN_DIST) / STEP + 1;
 
-// Definir PI si no está disponible
-#ifndef PI
-#define PI 3.14159265358979323846
+// — Actualización dispersa (solo el rango activo de la creencia) —
+// Con BAYES_SPARSE cada ciclo recorre los bins a menos de 13σ de las
+// lecturas en lugar de los NUM_BINS: mismo resultado, coste según σ / STEP.
+#define BAYES_SPARSE
+
+// — Creencia logarítmica (sin reinicios) —
+// Con BAYES_LOG la creencia es log2 entera (BayesLogGrid): recorre todos
+// los bins, pero con sumas enteras, y un salto del objeto fuera de la
+// creencia no la reinicia. Tiene prioridad sobre BAYES_SPARSE.
+//#define BAYES_LOG
+
+// — Creencia entera (mitad de SRAM) —
+// Con BAYES_INT la creencia es uint16_t (BayesIntGrid): 562 bytes en vez
+// de 1124 y sin coma flotante por bin. Se combina con BAYES_SPARSE.
+//#define BAYES_INT
+
+// — Paso de movimiento (predicción) —
+// Con BAYES_PREDICT cada actualización va precedida de predict(): la
+// creencia se ensancha σ = √(MOTION_RADIUS / 2) · STEP ≈ 0.14 cm por ciclo,
+// suficiente para objetos de ~15 cm/s con lecturas cada 10 ms. Sin él la
+// creencia se colapsa y un objeto que se mueve la reinicia una y otra vez.
+#define BAYES_PREDICT
+const uint8_t MOTION_RADIUS = 4;
+
+// — Rejilla de dos niveles (alcance completo del HC-SR04) —
+// Con BAYES_TWO_LEVEL la creencia cubre MIN_DIST-RANGE_MAX (400 cm) con una
+// rejilla gruesa de COARSE_STEP y una fina de FINE_BINS bins de STEP que
+// sigue al objeto: 100 + 128 bins (~980 bytes) en lugar de los 3981 de una
+// rejilla plana de 0.1 cm. MAX_DIST sigue siendo la zona de activación.
+// Tiene prioridad sobre BAYES_LOG y BAYES_INT.
+//#define BAYES_TWO_LEVEL
+#ifdef BAYES_TWO_LEVEL
+const float RANGE_MAX = 400.0;
+#else
+const float RANGE_MAX = MAX_DIST;
 #endif
+const float COARSE_STEP = 4.0;
+const int COARSE_BINS = (RANGE_MAX - MIN_DIST) / COARSE_STEP + 1;
+const int FINE_BINS = 128;
+
+// — Filtro de partículas (varias hipótesis) —
+// Con PARTICLE_FILTER la creencia son NUM_PARTICLES partículas enteras
+// (ParticleFilter, 4 bytes cada una: 384 con 96) en lugar de la rejilla.
+// Un eco espurio o un segundo objeto más profundo no la reinicia ni la
+// arrastra: cada uno queda como otra hipótesis. Usa el mismo predict().
+// Tiene prioridad sobre las demás opciones.
+//#define PARTICLE_FILTER
+const uint8_t NUM_PARTICLES = 96;
 
-// Variables para filtro bayesiano
-float belief[NUM_BINS];
+// Variables para filtro bayesiano (creencia en bayes_grid.h)
+#ifdef BAYES_SPARSE
+#define BAYES_SPARSE_ON true
+#else
+#define BAYES_SPARSE_ON false
+#endif
+#if defined(PARTICLE_FILTER)
+ParticleFilter<NUM_PARTICLES, 2> grid(MIN_DIST, RANGE_MAX, STEP);
+#elif defined(BAYES_TWO_LEVEL)
+BayesTwoLevelGrid<COARSE_BINS, FINE_BINS, 2> grid(MIN_DIST, COARSE_STEP, STEP);
+#elif defined(BAYES_LOG)
+BayesLogGrid<NUM_BINS, 2> grid(MIN_DIST, STEP);
+#elif defined(BAYES_INT)
+BayesIntGrid<NUM_BINS, 2, BAYES_SPARSE_ON> grid(MIN_DIST, STEP);
+#else
+BayesGrid<NUM_BINS, 2, BAYES_SPARSE_ON> grid(MIN_DIST, STEP);
+#endif
 float sigma1 = 0.4;
 float sigma2 = 0.4;
 
@@ -97,67 +159,36 @@ float read_distance(int trigPin, int echoPin) {
 
   
   float distance = duration * 0.0343 / 2.0;
-  return constrain(distance, MIN_DIST, MAX_DIST);
+  return constrain(distance, MIN_DIST, RANGE_MAX);
 }
 
 void init_belief() {
   // Inicializar con distribución uniforme
-  for (int i = 0; i < NUM_BINS; i++) {
-    belief[i] = 1.0 / NUM_BINS;
-  }
-}
-
-float gaussian(float x, float mu, float sigma) {
-  float exponent = -pow(x - mu, 2) / (2 * pow(sigma, 2));
-  return (1.0 / (sqrt(2 * PI) * sigma)) * exp(exponent);
+  grid.init();
 }
 
 void update_belief(float z1, float z2) {
   if (z1 < 0 || z2 < 0) return;
-  
-  float total = 0;
-  
+
+#ifdef BAYES_PREDICT
+  // Predicción: el objeto pudo moverse desde la lectura anterior
+  grid.predict<MOTION_RADIUS>();
+#endif
+
   // Aplicar Bayes: creencia posterior ∝ verosimilitud * creencia previa
-  for (int i = 0; i < NUM_BINS; i++) {
-    float x = MIN_DIST + i * STEP;
-    float p1 = gaussian(z1, x, sigma1);
-    float p2 = gaussian(z2, x, sigma2);
-    belief[i] *= p1 * p2;
-    total += belief[i];
-  }
-  
-  // Normalizar para asegurar que sumen 1
-  if (total > 0) {
-    for (int i = 0; i < NUM_BINS; i++) {
-      belief[i] /= total;
-    }
-  } else {
-    // Si todas las probabilidades son muy bajas, reiniciar
-    init_belief();
-  }
+  // (verosimilitud tabulada, normalizada y reiniciada si todo cae a cero)
+  const float z[2] = {z1, z2};
+  const float sigma[2] = {sigma1, sigma2};
+  grid.update(z, sigma);
 }
 
 float expected_value() {
-  float sum = 0;
-  float weight_sum = 0;
-  
-  for (int i = 0; i < NUM_BINS; i++) {
-    float x = MIN_DIST + i * STEP;
-    sum += x * belief[i];
-    weight_sum += belief[i];
-  }
-  
-  // Protección contra división por cero
-  if (weight_sum > 0) {
-    return sum / weight_sum;
-  } else {
-    return (MIN_DIST + MAX_DIST) / 2.0;  // Valor medio como fallback
-  }
+  return grid.expected();
 }
 
 void adaptive_noise(float z1, float z2) {
   // Incrementar sigma cuando las lecturas son inconsistentes
-  if ((z1 == MIN_DIST && z2 == MAX_DIST) || (z2 == MIN_DIST && z1 == MAX_DIST)) {
+  if ((z1 == MIN_DIST && z2 == RANGE_MAX) || (z2 == MIN_DIST && z1 == RANGE_MAX)) {
     sigma1 = constrain(sigma1 * 1.1, 0.2, 1.0);
     sigma2 = constrain(sigma2 * 1.1, 0.2, 1.0);
   } else {
@@ -3,19 +3,24 @@
 #define TRIG2 3
 #define ECHO2 4
 
+#include "bayes_grid.h"
+
 // Constantes para detección
 const float MIN_DIST = 2.0;
 const float MAX_DIST = 15.0;
 const float STEP = 0.1;
 const int NUM_BINS = (MAX_DIST - MIN_DIST) / STEP + 1;
 
-// Definir PI si no está disponible
-#ifndef PI
-#define PI 3.14159265358979323846
-#endif
+// — Paso de movimiento (predicción) —
+// Con BAYES_PREDICT cada actualización va precedida de predict(): la
+// creencia se ensancha σ = √(MOTION_RADIUS / 2) · STEP ≈ 0.14 cm por ciclo,
+// suficiente para objetos de ~15 cm/s con lecturas cada 10 ms. Sin él la
+// creencia se colapsa y un objeto que se mueve la reinicia una y otra vez.
+#define BAYES_PREDICT
+const uint8_t MOTION_RADIUS = 4;
 
-// Variables para filtro bayesiano
-float belief[NUM_BINS];
+// Variables para filtro bayesiano (creencia en bayes_grid.h)
+BayesGrid<NUM_BINS, 2> grid(MIN_DIST, STEP);
 float sigma1 = 0.4;
 float sigma2 = 0.4;
 
@@ -105,57 +110,26 @@ float read_distance(int trigPin, int echoPin) {
 
 void init_belief() {
   // Inicializar con distribución uniforme
-  for (int i = 0; i < NUM_BINS; i++) {
-    belief[i] = 1.0 / NUM_BINS;
-  }
-}
-
-float gaussian(float x, float mu, float sigma) {
-  float exponent = -pow(x - mu, 2) / (2 * pow(sigma, 2));
-  return (1.0 / (sqrt(2 * PI) * sigma)) * exp(exponent);
+  grid.init();
 }
 
 void update_belief(float z1, float z2) {
   if (z1 < 0 || z2 < 0) return;
-  
-  float total = 0;
-  
+
+#ifdef BAYES_PREDICT
+  // Predicción: el objeto pudo moverse desde la lectura anterior
+  grid.predict<MOTION_RADIUS>();
+#endif
+
   // Aplicar Bayes: creencia posterior ∝ verosimilitud * creencia previa
-  for (int i = 0; i < NUM_BINS; i++) {
-    float x = MIN_DIST + i * STEP;
-    float p1 = gaussian(z1, x, sigma1);
-    float p2 = gaussian(z2, x, sigma2);
-    belief[i] *= p1 * p2;
-    total += belief[i];
-  }
-  
-  // Normalizar para asegurar que sumen 1
-  if (total > 0) {
-    for (int i = 0; i < NUM_BINS; i++) {
-      belief[i] /= total;
-    }
-  } else {
-    // Si todas las probabilidades son muy bajas, reiniciar
-    init_belief();
-  }
+  // (verosimilitud tabulada, normalizada y reiniciada si todo cae a cero)
+  const float z[2] = {z1, z2};
+  const float sigma[2] = {sigma1, sigma2};
+  grid.update(z, sigma);
 }
 
 float expected_value() {
-  float sum = 0;
-  float weight_sum = 0;
-  
-  for (int i = 0; i < NUM_BINS; i++) {
-    float x = MIN_DIST + i * STEP;
-    sum += x * belief[i];
-    weight_sum += belief[i];
-  }
-  
-  // Protección contra división por cero
-  if (weight_sum > 0) {
-    return sum / weight_sum;
-  } else {
-    return (MIN_DIST + MAX_DIST) / 2.0;  // Valor medio como fallback
-  }
+  return grid.expected();
 }
 
 void adaptive_noise(float z1, float z2) {
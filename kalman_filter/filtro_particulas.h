@@ -0,0 +1,175 @@
+// ============================================================
+//  FILTRO DE PARTÍCULAS PARA carrito*.cpp
+//  ParticleFilter<N, MeasDim>: N partículas en arrays estáticos, posición
+//  en 1/64 cm y peso en Q16 (uint16_t): 4·N bytes, 384 con 96 partículas.
+//  Misma interfaz que BayesGrid (init, predict<R>, update, expected), así
+//  que ocupa el mismo hueco en los sketches.
+//  A diferencia de la rejilla y del Kalman mantiene varias hipótesis a la
+//  vez (zona difusa, dos objetos a distinta profundidad): cada lectura
+//  puede ser un eco espurio u otro objeto, y la estimación es la media de
+//  un grupo de partículas (el que se sigue), no la de toda la nube.
+//  Todo entero por partícula; aleatorios xorshift de 16 bits.
+// ============================================================
+
+#ifndef FILTRO_PARTICULAS_H
+#define FILTRO_PARTICULAS_H
+
+#include "bayes_grid.h"  // verosimilitud tabulada (bayes_likelihood/bayes_lookup_q16)
+
+#define PARTICLE_SHIFT 6                          // posiciones en 1/64 cm
+#define PARTICLE_OUTLIER 8192                     // Q16: eco espurio (1/8)
+#define PARTICLE_CLUSTER (2 << PARTICLE_SHIFT)    // grupo: ±2 cm de su centro
+#define PARTICLE_HOLD 6                           // grupo nuevo: 64 veces más peso
+#define PARTICLE_GAUSS_SIGMA 147.8f               // σ de gauss()
+
+template <uint8_t N, uint8_t MeasDim>
+class ParticleFilter {
+  static_assert(N <= 128, "Σ d·peso y el peso del grupo << PARTICLE_HOLD deben caber en 32 bits");
+public:
+  uint16_t pos[N];     // 1/64 cm
+  uint16_t weight[N];  // Q16; durante el remuestreo, copias de cada partícula
+
+  ParticleFilter(float minDist0, float maxDist0, float step0)
+      : lo((uint16_t)(minDist0 * (1 << PARTICLE_SHIFT))), hi((uint16_t)(maxDist0 * (1 << PARTICLE_SHIFT))),
+        step(step0), rng(0xACE1) {
+    init();
+  }
+
+  // Partículas repartidas por igual en todo el rango
+  void init() {
+    for (uint8_t i = 0; i < N; i++) pos[i] = lo + (uint32_t)(hi - lo) * i / (N - 1);
+    mean = (float)(lo + hi) / (2 << PARTICLE_SHIFT);
+    track = (lo + hi) / 2;
+  }
+
+  // Paso de movimiento: ruido de σ = √(R/2) · STEP, el mismo que el núcleo
+  // de predict<R>() en BayesGrid
+  template <uint8_t R>
+  void predict() {
+    const uint16_t k = (uint16_t)(sqrtf(R / 2.0f) * step * (256 << PARTICLE_SHIFT) / PARTICLE_GAUSS_SIGMA + 0.5f);
+    for (uint8_t i = 0; i < N; i++) pos[i] = clamp(pos[i] + (((int32_t)gauss() * k) >> 8));
+  }
+
+  // Pesos, estimación, remuestreo sistemático y reinyección en O(N)
+  void update(const float z[MeasDim], const float sigma[MeasDim]) {
+    BayesLikelihood l[MeasDim];
+    uint8_t valid = 0;
+    for (uint8_t m = 0; m < MeasDim; m++) {
+      if (z[m] > 0) {
+        l[m] = bayes_likelihood(z[m], sigma[m], 0, 1.0f / (1 << PARTICLE_SHIFT));
+        valid++;
+      } else {
+        l[m] = bayes_likelihood_none();
+      }
+    }
+    if (valid == 0) return;
+    // Peso: producto por sensor de (1 - ε)·L + ε, nunca 0 (ε: eco espurio)
+    uint32_t total = 0;
+    uint8_t best = 0;
+    for (uint8_t i = 0; i < N; i++) {
+      uint32_t w = 65535;
+      for (uint8_t m = 0; m < MeasDim; m++) {
+        uint32_t p = PARTICLE_OUTLIER + (((uint32_t)bayes_lookup_q16(l[m], pos[i]) * (65536 - PARTICLE_OUTLIER)) >> 16);
+        w = (w * p) >> 16;
+      }
+      weight[i] = w;
+      total += w;
+      if (w > weight[best]) best = i;
+    }
+    estimate(best);
+    resample(total);
+    // Unas pocas partículas nuevas junto a las lecturas: si el objeto
+    // aparece lejos de la nube, la recupera sin reiniciar
+    for (uint8_t j = 0, m = 0; j < N / 16; j++, m = (m + 1) % MeasDim) {
+      if (z[m] <= 0) continue;
+      const uint16_t k = (uint16_t)(sigma[m] * (256 << PARTICLE_SHIFT) / PARTICLE_GAUSS_SIGMA);
+      pos[next() % N] = clamp((int32_t)l[m].center + (((int32_t)gauss() * k) >> 8));
+    }
+  }
+
+  // Media del grupo más pesado (cm), calculada en update()
+  float expected() const { return mean; }
+
+private:
+  uint16_t lo, hi;  // rango en 1/64 cm
+  float step;
+  float mean;
+  uint16_t rng;
+  uint16_t track;  // centro del grupo seguido (1/64 cm)
+
+  uint16_t clamp(int32_t p) const { return (p < lo) ? lo : ((p > hi) ? hi : p); }
+
+  // xorshift de 16 bits (7, 9, 8): periodo 65535
+  uint16_t next() {
+    rng ^= rng << 7;
+    rng ^= rng >> 9;
+    rng ^= rng << 8;
+    return rng;
+  }
+
+  // Casi gaussiano: suma de cuatro bytes aleatorios centrada (σ ≈ 147.8)
+  int16_t gauss() {
+    uint16_t a = next(), b = next();
+    return (int16_t)((a & 0xFF) + (a >> 8) + (b & 0xFF) + (b >> 8)) - 510;
+  }
+
+  // Media ponderada del grupo seguido (±PARTICLE_CLUSTER de track). El
+  // grupo de la partícula más pesada lo sustituye solo si pesa más de
+  // 2^PARTICLE_HOLD veces que él: un ciclo con ecos del otro objeto no
+  // basta para saltar de uno a otro
+  void estimate(uint8_t best) {
+    const uint16_t center = pos[best];
+    uint32_t sw[2] = {0, 0};
+    int32_t sd[2] = {0, 0};
+    for (uint8_t i = 0; i < N; i++) {
+      int16_t d = pos[i] - track;
+      if (d >= -PARTICLE_CLUSTER && d <= PARTICLE_CLUSTER) {
+        sw[0] += weight[i];
+        sd[0] += (int32_t)d * weight[i];
+      }
+      d = pos[i] - center;
+      if (d >= -PARTICLE_CLUSTER && d <= PARTICLE_CLUSTER) {
+        sw[1] += weight[i];
+        sd[1] += (int32_t)d * weight[i];
+      }
+    }
+    uint8_t g = 0;
+    if (sw[1] > (sw[0] << PARTICLE_HOLD)) {
+      track = center;
+      g = 1;
+    }
+    mean = (track + (float)sd[g] / sw[g]) / (1 << PARTICLE_SHIFT);
+    track = (uint16_t)(mean * (1 << PARTICLE_SHIFT) + 0.5f);
+  }
+
+  // Remuestreo sistemático: N punteros separados total / N desde un único
+  // aleatorio. weight[i] pasa a ser el número de copias de i y las copias
+  // extra ocupan, en su sitio, los huecos de las partículas que no salen
+  void resample(uint32_t total) {
+    const uint32_t stride = total / N;  // >= 1024: cada peso es >= ε²
+    uint32_t u = ((uint32_t)next() * stride) >> 16;
+    uint32_t cum = 0;
+    uint8_t made = 0;
+    for (uint8_t i = 0; i < N; i++) {
+      cum += weight[i];
+      uint8_t copies = 0;
+      while (u < cum && made < N) {
+        copies++;
+        made++;
+        u += stride;
+      }
+      weight[i] = copies;
+    }
+    uint8_t hole = 0;
+    for (uint8_t i = 0; i < N; i++) {
+      while (weight[i] > 1) {
+        while (weight[hole] != 0) hole++;
+        pos[hole] = pos[i];
+        weight[hole] = 1;
+        weight[i]--;
+      }
+    }
+  }
+};
+
+#endif
@@ -1,3 +1,5 @@
+#include "kalman.h"
+
 #define TRIG1 11
 #define ECHO1 12
 #define TRIG2 3
@@ -27,11 +29,10 @@ float estimationHistory[HISTORY_SIZE] = {0};
 int historyIndex = 0;
 
 // Parámetros del filtro de Kalman (simplificado para 1D)
-float kalman_x = 10.0;       // Estimación inicial (cm)
-float kalman_p = 1.0;        // Incertidumbre inicial
-float kalman_q = 0.01;       // Ruido del proceso (ajustar según velocidad de cambio esperada)
-float kalman_r1 = 0.5;       // Ruido de medición sensor 1 (ajustar según precisión del sensor)
-float kalman_r2 = 0.5;       // Ruido de medición sensor 2
+// Estimación inicial 10 cm, incertidumbre 1.0, ruido del proceso 0.01
+// (ajustar según velocidad de cambio esperada)
+KalmanFilter<float, 1, 2> kalman(10.0, 1.0, 0.01);
+float kalman_r[2] = {0.5, 0.5};  // Ruido de medición de cada sensor (ajustar según precisión del sensor)
 
 void setup() {
   Serial.begin(9600);
@@ -71,7 +72,7 @@ void loop() {
     Serial.print("z1: "); Serial.print(z1);
     Serial.print(", z2: "); Serial.print(z2);
     Serial.print(", Kalman: "); Serial.print(kalman_estimate);
-    Serial.print(", P: "); Serial.print(kalman_p);
+    Serial.print(", P: "); Serial.print(kalman.p);
     Serial.print(", Var: "); Serial.print(variation);
     
     // CRÍTICO: Verificar si las estimaciones son seguras
@@ -92,7 +93,7 @@ void loop() {
         kalman_estimate <= safeMaxDistance && 
         allHistoryValid &&
         stableReading &&
-        kalman_p < 0.3 &&  // Baja incertidumbre en la estimación
+        kalman.p < 0.3 &&  // Baja incertidumbre en la estimación
         currentLedState == LED_OFF) {
       
       // Verificación adicional crítica: ambos sensores deben estar en rango seguro
@@ -112,7 +113,7 @@ void loop() {
         Serial.println(" - NO ACTIVANDO: histórico reciente fuera de rango seguro");
       } else if (!stableReading) {
         Serial.println(" - NO ACTIVANDO: lecturas inestables");
-      } else if (kalman_p >= 0.3) {
+      } else if (kalman.p >= 0.3) {
         Serial.println(" - NO ACTIVANDO: alta incertidumbre en estimación");
       } else if (currentLedState != LED_OFF) {
         Serial.println(" - LED ya está en ciclo de activación");
@@ -168,40 +169,30 @@ float read_distance(int trigPin, int echoPin) {
 float update_kalman(float z1, float z2) {
   // 1. Predicción (sin cambio en x porque asumimos objeto estacionario)
   // x = x (no cambia)
-  kalman_p = kalman_p + kalman_q;
-  
-  // 2. Actualización con la primera medición (si es válida)
-  if (z1 > 0) {
-    float k = kalman_p / (kalman_p + kalman_r1);
-    kalman_x = kalman_x + k * (z1 - kalman_x);
-    kalman_p = (1 - k) * kalman_p;
-  }
+  kalman.predict();
   
-  // 3. Actualización con la segunda medición (si es válida)
-  if (z2 > 0) {
-    float k = kalman_p / (kalman_p + kalman_r2);
-    kalman_x = kalman_x + k * (z2 - kalman_x);
-    kalman_p = (1 - k) * kalman_p;
-  }
+  // 2. Actualización con cada medición válida
+  const float z[2] = {z1, z2};
+  kalman.update(z, kalman_r);
   
   // Ajustar ruido de medición dinámicamente
   if (z1 > 0 && z2 > 0) {
     float diff = abs(z1 - z2);
     if (diff > 1.0) {
       // Si los sensores difieren mucho, aumentar el ruido
-      kalman_r1 = constrain(kalman_r1 * 1.05, 0.1, 2.0);
-      kalman_r2 = constrain(kalman_r2 * 1.05, 0.1, 2.0);
+      kalman_r[0] = constrain(kalman_r[0] * 1.05, 0.1, 2.0);
+      kalman_r[1] = constrain(kalman_r[1] * 1.05, 0.1, 2.0);
     } else {
       // Si son consistentes, reducir el ruido
-      kalman_r1 = constrain(kalman_r1 * 0.95, 0.1, 2.0);
-      kalman_r2 = constrain(kalman_r2 * 0.95, 0.1, 2.0);
+      kalman_r[0] = constrain(kalman_r[0] * 0.95, 0.1, 2.0);
+      kalman_r[1] = constrain(kalman_r[1] * 0.95, 0.1, 2.0);
     }
   }
   
   // Aplicar restricciones a la estimación
-  kalman_x = constrain(kalman_x, MIN_DIST, MAX_DIST);
+  kalman.x = constrain(kalman.x, MIN_DIST, MAX_DIST);
   
-  return kalman_x;
+  return kalman.x;
 }
 
 float calculate_history_variation() {
@@ -3,12 +3,14 @@
 #define TRIG2 3
 #define ECHO2 4
 
+#include "bayes_grid.h"
+
 const float MIN_DIST = 2.0;
 const float MAX_DIST = 15.0;
 const float STEP = 0.1;
 const int NUM_BINS = (MAX_DIST - MIN_DIST) / STEP + 1;
 
-float belief[NUM_BINS];
+BayesGrid<NUM_BINS, 2> grid(MIN_DIST, STEP);
 float sigma1 = 0.4;
 float sigma2 = 0.4;
 
@@ -70,37 +72,17 @@ float read_distance(int trigPin, int echoPin) {
 }
 
 void init_belief() {
-  for (int i = 0; i < NUM_BINS; i++) {
-    belief[i] = 1.0 / NUM_BINS;
-  }
-}
-
-float gaussian(float x, float mu, float sigma) {
-  float exponent = - (pow(x - mu, 2)) / (2 * pow(sigma, 2));
-  return (1.0 / (sqrt(2 * PI) * sigma)) * exp(exponent);
+  grid.init();
 }
 
 void update_belief(float z1, float z2) {
-  float total = 0;
-  for (int i = 0; i < NUM_BINS; i++) {
-    float x = MIN_DIST + i * STEP;
-    float p1 = gaussian(z1, x, sigma1);
-    float p2 = gaussian(z2, x, sigma2);
-    belief[i] *= p1 * p2;
-    total += belief[i];
-  }
-  for (int i = 0; i < NUM_BINS; i++) {
-    belief[i] /= total;
-  }
+  const float z[2] = {z1, z2};
+  const float sigma[2] = {sigma1, sigma2};
+  grid.update(z, sigma);
 }
 
 float expected_value() {
-  float sum = 0;
-  for (int i = 0; i < NUM_BINS; i++) {
-    float x = MIN_DIST + i * STEP;
-    sum += x * belief[i];
-  }
-  return sum;
+  return grid.expected();
 }
 
 void adaptive_noise(float z1, float z2) {
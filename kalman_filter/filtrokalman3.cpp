@@ -4,6 +4,8 @@
 //  Distancias en cm, tiempos en ms
 // ============================================================
 
+#include "kalman.h"
+
 #define TRIG1 11
 #define ECHO1 12
 #define TRIG2  3
@@ -35,12 +37,10 @@ float estimationHistory[HISTORY_SIZE] = {0};
 int historyIndex = 0;
 
 // ————— Variables Kalman 1D —————
-float kalman_x  = 10.0;  // estado inicial (cm)
-float kalman_p  = 1.0;   // incertidumbre inicial
 const float kalman_q0 = 0.01;  // ruido de proceso fijo
-float kalman_q  = kalman_q0;
-float kalman_r1 = 0.5;   // ruido medición sensor 1
-float kalman_r2 = 0.5;   // ruido medición sensor 2
+// estado inicial 10 cm, incertidumbre inicial 1.0
+KalmanFilter<float, 1, 2> kalman(10.0, 1.0, kalman_q0);
+float kalman_r[2] = {0.5, 0.5};  // ruido medición de cada sensor
 
 void setup() {
   Serial.begin(9600);
@@ -75,7 +75,7 @@ void loop() {
     Serial.print("z1: "); Serial.print(z1);
     Serial.print("  z2: "); Serial.print(z2);
     Serial.print("  K: ");  Serial.print(estimate);
-    Serial.print("  P: ");  Serial.print(kalman_p);
+    Serial.print("  P: ");  Serial.print(kalman.p);
     Serial.print("  Var: ");Serial.print(variation);
 
     // Condiciones de activación
@@ -88,7 +88,7 @@ void loop() {
       }
     }
     bool stable = (variation < 0.2);
-    bool lowUncert = (kalman_p < 0.3);
+    bool lowUncert = (kalman.p < 0.3);
 
     if (estimate >= MIN_DIST && estimate <= safeMax
         && allValid && stable && lowUncert
@@ -159,38 +159,29 @@ float read_distance(int trigPin, int echoPin) {
 
 float update_kalman(float z1, float z2) {
   // Predicción
-  kalman_p += kalman_q;
+  kalman.predict();
 
-  // Actualiza con z1
-  if (z1 > 0) {
-    float k = kalman_p / (kalman_p + kalman_r1);
-    kalman_x += k * (z1 - kalman_x);
-    kalman_p *= (1 - k);
-  }
-  // Actualiza con z2
-  if (z2 > 0) {
-    float k = kalman_p / (kalman_p + kalman_r2);
-    kalman_x += k * (z2 - kalman_x);
-    kalman_p *= (1 - k);
-  }
+  // Actualiza con z1 y z2
+  const float z[2] = {z1, z2};
+  kalman.update(z, kalman_r);
 
   // Ajuste dinámico de ruido de medición
   if (z1>0 && z2>0) {
     float diff = abs(z1 - z2);
     if (diff > 1.0) {
-      kalman_r1 = constrain(kalman_r1 * 1.05, 0.1, 2.0);
-      kalman_r2 = constrain(kalman_r2 * 1.05, 0.1, 2.0);
+      kalman_r[0] = constrain(kalman_r[0] * 1.05, 0.1, 2.0);
+      kalman_r[1] = constrain(kalman_r[1] * 1.05, 0.1, 2.0);
     } else {
-      kalman_r1 = constrain(kalman_r1 * 0.95, 0.1, 2.0);
-      kalman_r2 = constrain(kalman_r2 * 0.95, 0.1, 2.0);
+      kalman_r[0] = constrain(kalman_r[0] * 0.95, 0.1, 2.0);
+      kalman_r[1] = constrain(kalman_r[1] * 0.95, 0.1, 2.0);
     }
   }
 
   // Constrain estado
-  kalman_x = constrain(kalman_x, MIN_DIST, MAX_DIST);
+  kalman.x = constrain(kalman.x, MIN_DIST, MAX_DIST);
   // Reset q steady
-  kalman_q = kalman_q0;
-  return kalman_x;
+  kalman.q = kalman_q0;
+  return kalman.x;
 }
 
 float calculate_history_variation() {
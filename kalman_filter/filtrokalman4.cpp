@@ -5,6 +5,7 @@
 // ============================================================
 
 #include <avr/pgmspace.h>
+#include "kalman.h"
 
 // — Definiciones de pines —
 #define TRIG1 11
@@ -43,12 +44,10 @@ uint8_t estimationHistory[HISTORY_SIZE] = {0};  // Cambiado a uint8_t
 uint8_t historyIndex = 0;
 
 // — Variables Kalman 1D (optimizadas) —
-uint8_t kalman_x = 10;          // estado inicial (cm) como entero
-uint8_t kalman_p_x10 = 10;      // incertidumbre inicial x10 para precisión sin flotantes
 const uint8_t kalman_q0_x100 = 1; // ruido de proceso fijo x100 (0.01)
-uint8_t kalman_q_x100 = 1;
-uint8_t kalman_r1_x10 = 5;      // ruido medición sensor 1 x10 (0.5)
-uint8_t kalman_r2_x10 = 5;      // ruido medición sensor 2 x10 (0.5)
+// estado inicial 10 cm como entero, incertidumbre inicial x10 para precisión sin flotantes
+KalmanFilter<Tenths, 1, 2> kalman(10, Tenths{10}, Tenths{kalman_q0_x100 / 10});  // q_x100/10 para mantener escala x10
+Tenths kalman_r[2] = {{5}, {5}};  // ruido medición de cada sensor x10 (0.5)
 
 // — Umbrales pre-calculados para optimizar comparaciones —
 const uint8_t SAFE_MAX_DIST = MAX_DIST - SAFETY_MARGIN;  // 18 cm
@@ -110,7 +109,7 @@ void loop() {
       Serial.print(F("z1:"));  Serial.print(z1);
       Serial.print(F(" z2:")); Serial.print(z2);
       Serial.print(F(" K:"));  Serial.print(estimate);
-      Serial.print(F(" P:"));  Serial.print(kalman_p_x10);
+      Serial.print(F(" P:"));  Serial.print(kalman.p.v);
       Serial.print(F(" V:"));  Serial.print(variation);
     #endif
 
@@ -125,7 +124,7 @@ void loop() {
     
     // Evaluación de estabilidad y certidumbre (optimizada)
     bool stable = (variation <= STABLE_THRESHOLD_X10);
-    bool lowUncert = (kalman_p_x10 < UNCERT_THRESHOLD_X10);
+    bool lowUncert = (kalman.p.v < UNCERT_THRESHOLD_X10);
 
     // Lógica de activación (simplificada y optimizada)
     if (estimate >= MIN_DIST && estimate <= SAFE_MAX_DIST && 
@@ -220,33 +219,11 @@ uint8_t read_distance(uint8_t trigPin, uint8_t echoPin) {
 // Filtro Kalman optimizado para enteros con escalado para mantener precisión
 uint8_t update_kalman(uint8_t z1, uint8_t z2) {
   // — Predicción (trabajando con valores escalados) —
-  kalman_p_x10 += (kalman_q_x100 / 10);  // q_x100/10 para mantener escala x10
+  kalman.predict();
   
-  // — Actualización con z1 (si válido) —
-  if (z1 > 0) {
-    // Cálculo de ganancia Kalman optimizado
-    uint16_t denominator = kalman_p_x10 + kalman_r1_x10;
-    uint8_t k_x10 = (denominator > 0) ? ((10 * kalman_p_x10) / denominator) : 0;
-    
-    // Actualización de estado optimizada para evitar desbordamiento
-    int16_t innovation = ((int16_t)z1 - (int16_t)kalman_x);
-    kalman_x += (k_x10 * innovation) / 10;
-    
-    // Actualización de covarianza optimizada
-    kalman_p_x10 = (kalman_p_x10 * (10 - k_x10)) / 10;
-  }
-  
-  // — Actualización con z2 (si válido) —
-  if (z2 > 0) {
-    // Mismo proceso para z2
-    uint16_t denominator = kalman_p_x10 + kalman_r2_x10;
-    uint8_t k_x10 = (denominator > 0) ? ((10 * kalman_p_x10) / denominator) : 0;
-    
-    int16_t innovation = ((int16_t)z2 - (int16_t)kalman_x);
-    kalman_x += (k_x10 * innovation) / 10;
-    
-    kalman_p_x10 = (kalman_p_x10 * (10 - k_x10)) / 10;
-  }
+  // — Actualización con z1 y z2 (si válidos) —
+  const uint16_t z[2] = {z1, z2};
+  kalman.update(z, kalman_r);
   
   // — Ajuste dinámico de ruido de medición (simplificado y optimizado) —
   if (z1 > 0 && z2 > 0) {
@@ -254,25 +231,22 @@ uint8_t update_kalman(uint8_t z1, uint8_t z2) {
     
     if (diff > 1) {
       // Aumentar ruido (sensores discrepan)
-      if (kalman_r1_x10 < 20) kalman_r1_x10++;  // Máximo 2.0
-      if (kalman_r2_x10 < 20) kalman_r2_x10++;
+      if (kalman_r[0].v < 20) kalman_r[0].v++;  // Máximo 2.0
+      if (kalman_r[1].v < 20) kalman_r[1].v++;
     } else {
       // Disminuir ruido (sensores concuerdan)
-      if (kalman_r1_x10 > 1) kalman_r1_x10--;  // Mínimo 0.1
-      if (kalman_r2_x10 > 1) kalman_r2_x10--;
+      if (kalman_r[0].v > 1) kalman_r[0].v--;  // Mínimo 0.1
+      if (kalman_r[1].v > 1) kalman_r[1].v--;
     }
   }
   
   
   
   // — Restricción del estado estimado —
-  if (kalman_x < MIN_DIST) kalman_x = MIN_DIST;
-  if (kalman_x > MAX_DIST) kalman_x = MAX_DIST;
-  
-  // — Reset q —
-  kalman_q_x100 = kalman_q0_x100;
+  if (kalman.x < MIN_DIST) kalman.x = MIN_DIST;
+  if (kalman.x > MAX_DIST) kalman.x = MAX_DIST;
   
-  return kalman_x;
+  return kalman.x;
 }
 
 // Cálculo de variación en historial optimizado para enteros
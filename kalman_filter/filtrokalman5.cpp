@@ -2,7 +2,7 @@
 
 //  SISTEMA OPTIMIZADO DE DETECCIÓN Y ACTIVACIÓN DE BOOST CON FILTRO KALMAN
 
-//  Para dos sensores HC-SR04 en Arduino UNO (16 MHz, 2 KB SRAM)
+//  Para N sensores HC-SR04 en Arduino UNO (16 MHz, 2 KB SRAM)
 
 //  Optimización: Memoria, Rendimiento y Determinismo Temporal
 
@@ -10,19 +10,11 @@
 
   
 
-#include <avr/pgmspace.h>
+#include "kalman.h"  // incluye avr/pgmspace.h
 
   
 
-// — Definiciones de pines —
-
-#define TRIG1 11
-
-#define ECHO1 12
-
-#define TRIG2 3
-
-#define ECHO2 4
+// — Definiciones de pines (los sensores se declaran en SENSOR_PINS) —
 
 #define LED_PIN 2  // LED_BUILTIN es generalmente el pin 13
 
@@ -34,6 +26,28 @@
 
   
 
+// — Repetición en PC (afinador.cpp) —
+
+// Con KALMAN_REPLAY el sketch compila sin hardware: sin captura de ecos,
+
+// setup() ni loop(); el afinador entrega las lecturas de una captura a
+
+// process_cycle() y los parámetros TUNABLE pasan a ser variables que
+
+// asigna antes de cada repetición. En el Arduino son constantes.
+
+#ifdef KALMAN_REPLAY
+
+#define TUNABLE
+
+#else
+
+#define TUNABLE const
+
+#endif
+
+  
+
 // — Parámetros de distancia (en PROGMEM para ahorrar RAM) —
 
 const PROGMEM uint8_t MIN_DIST = 2;            // cm, mínimo útil
@@ -80,11 +94,31 @@ unsigned long ledStartMillis = 0;
 
   
 
+// — Distancias en punto fijo Q8.8 (cm * 256, resolución ~0.04 mm) —
+
+// Todo el camino medición -> Kalman -> historial trabaja en Q8.8 sobre
+
+// uint16_t: sin flotantes y sin cuantizar a centímetros enteros.
+
+#define CM_Q8(cm) ((uint16_t)(cm) << 8)
+
+  
+
 // — Historial para estabilidad (optimizado para usar enteros) —
 
+#ifndef HISTORY_SIZE
+
 #define HISTORY_SIZE 5
 
-uint8_t estimationHistory[HISTORY_SIZE] = {0};  // Cambiado a uint8_t
+#endif
+
+#ifndef HISTORY_CAPACITY
+
+#define HISTORY_CAPACITY HISTORY_SIZE  // el afinador la fija al máximo que prueba
+
+#endif
+
+uint16_t estimationHistory[HISTORY_CAPACITY] = {0};  // Q8.8
 
 uint8_t historyIndex = 0;
 
@@ -92,446 +126,2182 @@ uint8_t historyIndex = 0;
 
 // — Variables Kalman 1D (optimizadas) —
 
-uint8_t kalman_x = 10;          // estado inicial (cm) como entero
+const uint16_t kalman_x0 = CM_Q8(10);  // estado inicial (cm) en Q8.8
 
-uint8_t kalman_p_x10 = 10;      // incertidumbre inicial x10 para precisión sin flotantes
+const uint8_t kalman_p0_x10 = 10;  // incertidumbre inicial x10 para precisión sin flotantes
 
-const uint8_t kalman_q0_x100 = 1; // ruido de proceso fijo x100 (0.01)
+TUNABLE uint8_t kalman_q0_x100 = 1; // ruido de proceso fijo x100 (0.01)
 
-uint8_t kalman_q_x100 = 1;
+TUNABLE uint8_t kalman_r0_x10 = 5; // ruido medición inicial de cada sensor x10 (0.5)
 
-uint8_t kalman_r1_x10 = 5;      // ruido medición sensor 1 x10 (0.5)
+#define KALMAN_R_MAX_X10 20       // ruido de medición máximo x10 (2.0)
 
-uint8_t kalman_r2_x10 = 5;      // ruido medición sensor 2 x10 (0.5)
+#define KALMAN_P_MAX 400          // cm², tope de P sin lecturas (Q16.16 no desborda)
 
   
 
-// — Umbrales pre-calculados para optimizar comparaciones —
+// Por defecto el filtro 1D trabaja en Q16.16 (estado, P, q y R, ver
 
-const uint8_t SAFE_MAX_DIST = MAX_DIST - SAFETY_MARGIN;  // 18 cm
+// kalman.h): q = 0.01 es representable y P no colapsa. KALMAN_X10 conserva
+
+// el filtro compacto en décimas sobre uint8_t; ahí q = 0.01 truncado es 0,
 
-const uint8_t STABLE_THRESHOLD_X10 = 2;  // 0.2 * 10
+// P colapsa a 0 y la estimación se congela, así que q se redondea hacia
 
-const uint8_t UNCERT_THRESHOLD_X10 = 3;  // 0.3 * 10
+// arriba a 0.1, la menor décima.
+
+//#define KALMAN_X10
 
   
 
-// — Factor para convertir duración a distancia (optimizado) —
+// — Estimación adaptativa de ruido (Sage–Husa, Q16.16) —
 
-// Original: duration * 0.0343 / 2.0
+// Con NOISE_ESTIMATION cada sensor estima su propio R a partir de su
 
-// Simplificado a: duration / 58 (estándar para HC-SR04 en cm)
+// innovación frente al estado predicho (R ≈ media de e² - P) y el filtro
 
-#define DURATION_TO_CM_DIVISOR 58
+// 1D estima q con la corrección de cada ciclo (q ≈ media de Δx² + P - P
 
-  
+// anterior). Medias exponenciales con olvido 2^-NOISE_FORGET_SHIFT: un
 
-// — Tiempo máximo de espera para echo en microsegundos —
+// desplazamiento y unas sumas por sensor y ciclo, sin divisiones. Un sensor
 
-// 25000 μs corresponde a ~4.3m (máximo teórico HC-SR04)
+// degradado ya no penaliza a los demás. R no se estima mientras P supere
 
-#define ECHO_TIMEOUT 25000
+// al mayor R (al re-adquirir o al volver el objeto), ni q con el salto de
+
+// x de una re-adquisición. Solo en el filtro 1D: con KALMAN_X10 sigue la
+
+// regla ±1 de adapt_measurement_noise, y con KALMAN_CV R queda fija: con
+
+// R estimada (0.1 en el sensor bueno) la velocidad sigue al ruido y la
+
+// posición proyectada pierde más el seguimiento que con R fija.
+
+// NO_NOISE_ESTIMATION la quita al compilar una prueba de PC
+
+// (prueba_ruido.cpp).
+
+#ifndef NO_NOISE_ESTIMATION
+
+#define NOISE_ESTIMATION
+
+#endif
+
+#define NOISE_FORGET_SHIFT 5      // olvido 1/32: ventana efectiva ~32 ciclos (0.3 s)
+
+#define NOISE_Q_MAX 4             // cm², tope de q estimado
 
   
 
-// — Declaraciones de funciones —
+// — Tabla de ganancias precalculada (solo con KALMAN_X10) —
+
+// Con KALMAN_GAIN_TABLE cada actualización secuencial toma K y P' de una
 
-uint8_t read_distance(uint8_t trigPin, uint8_t echoPin);
+// tabla en flash generada en compilación (kalman.h) para P <= 1.5 y todo
 
-uint8_t update_kalman(uint8_t z1, uint8_t z2);
+// R, en lugar de la división 10·P / (P + R). Con P mayor (re-adquisición,
 
-uint8_t calculate_history_variation();
+// objeto que vuelve) se divide, como mucho en las dos actualizaciones
+
+// siguientes.
+
+//#define KALMAN_GAIN_TABLE
 
   
 
-void setup() {
+// — Fusión en forma de información (solo filtro 1D) —
 
-  // Configuración de pines optimizada (escritura directa a registros)
+// Con KALMAN_FUSED todas las lecturas válidas del ciclo entran en un único
 
-  pinMode(TRIG1, OUTPUT);
+// paso sumando informaciones 1/r (una división por ciclo) en lugar de N
 
-  pinMode(ECHO1, INPUT);
+// actualizaciones secuenciales con una división de ganancia cada una.
 
-  pinMode(TRIG2, OUTPUT);
+// 1/r de cada r x10 posible sale de una tabla en flash.
 
-  pinMode(ECHO2, INPUT);
+//#define KALMAN_FUSED
 
-  pinMode(LED_PIN, OUTPUT);
+constexpr uint16_t info_q12(uint8_t r_x10) {
 
-  pinMode(LED_INDICATOR, OUTPUT);
+  return (r_x10 == 0) ? 0 : (KALMAN_INFO_ONE + r_x10 / 2) / r_x10;
+
+}
+
+const uint16_t INFO_Q12_TABLE[KALMAN_R_MAX_X10 + 1] PROGMEM = {
+
+  info_q12(0),  info_q12(1),  info_q12(2),  info_q12(3),  info_q12(4),
+
+  info_q12(5),  info_q12(6),  info_q12(7),  info_q12(8),  info_q12(9),
+
+  info_q12(10), info_q12(11), info_q12(12), info_q12(13), info_q12(14),
+
+  info_q12(15), info_q12(16), info_q12(17), info_q12(18), info_q12(19),
+
+  info_q12(20)
+
+};
 
   
 
-  digitalWrite(LED_PIN, LOW);
+// — Kalman de velocidad constante (posición + velocidad, Q16.16) —
 
-  digitalWrite(LED_INDICATOR, LOW);
+// Con KALMAN_CV el estado es [x, v] con modelo de aceleración blanca en
+
+// lugar de "objeto estacionario": un objeto que se acerca no arrastra
+
+// retraso, se estima su velocidad y el tiempo hasta contacto (x / -v), y la
+
+// activación evalúa la posición proyectada CV_LEAD_MS hacia adelante.
+
+//#define KALMAN_CV
+
+#define CV_ACCEL_NOISE 200    // cm/s², σ de la aceleración del objeto
+
+#define CV_INIT_SPEED 100     // cm/s, σ inicial de la velocidad
+
+#define CV_MAX_SPEED 1000     // cm/s, límite físico de la estimación
+
+#define CV_LEAD_MS 100        // ms de anticipación de la activación
+
+#define CV_LOST_P00 400       // cm², sin lecturas por encima de esto se reinicia P
 
   
 
-  #ifdef DEBUG
+// Ruido de proceso σa² · dt^p / div en Q16.16, con dt = READ_INTERVAL
 
-    Serial.begin(9600);
+constexpr int32_t cv_process_noise(uint8_t p, uint8_t div, long long dtPow, long long msPow) {
 
-    Serial.println(F("SISTEMA INICIADO - OPTIMIZADO"));
+  return p == 0 ? (int32_t)((long long)CV_ACCEL_NOISE * CV_ACCEL_NOISE * dtPow * Q16_ONE / (msPow * div))
 
-  #endif
+                : cv_process_noise(p - 1, div, dtPow * READ_INTERVAL, msPow * 1000);
 
 }
 
+const int32_t CV_Q00 = cv_process_noise(4, 4, 1, 1);  // dt⁴/4 · σa²
+
+const int32_t CV_Q01 = cv_process_noise(3, 2, 1, 1);  // dt³/2 · σa²
+
+const int32_t CV_Q11 = cv_process_noise(2, 1, 1, 1);  // dt² · σa²
+
+const int32_t CV_DT_Q16 = (int32_t)READ_INTERVAL * Q16_ONE / 1000;
+
+const int32_t CV_LEAD_Q16 = ((int32_t)CV_LEAD_MS * Q16_ONE + 500) / 1000;  // s
+
+const int32_t CV_P11_0 = (int32_t)CV_INIT_SPEED * CV_INIT_SPEED * Q16_ONE;  // cm²/s²
+
   
 
-void loop() {
+// — Umbrales pre-calculados para optimizar comparaciones —
 
-  unsigned long now = millis();
+const uint8_t SAFE_MAX_DIST = MAX_DIST - SAFETY_MARGIN;  // 18 cm
+
+TUNABLE uint8_t UNCERT_THRESHOLD_X10 = 3;  // 0.3 * 10
+
+const uint16_t MIN_DIST_Q8 = CM_Q8(MIN_DIST);
+
+const uint16_t MAX_DIST_Q8 = CM_Q8(MAX_DIST);
+
+const uint16_t SAFE_MAX_DIST_Q8 = CM_Q8(SAFE_MAX_DIST);
+
+const uint16_t ACTIVATION_MIN_Q8 = CM_Q8(ACTIVATION_MIN);
+
+const uint16_t OUT_OF_RANGE_Q8 = CM_Q8(MAX_DIST + 1);  // marca de zona difusa
+
+TUNABLE uint16_t STABLE_THRESHOLD_Q8 = 51;  // 0.2 cm * 256
+
+const uint16_t SENSOR_AGREEMENT_Q8 = CM_Q8(1);  // discrepancia tolerada entre sensores
 
   
 
-  // — Lectura y filtro cada READ_INTERVAL ms —
+// — Factor para convertir duración a distancia (optimizado) —
+
+// Original: duration * 0.0343 / 2.0
+
+// Simplificado a: duration / 58 (estándar para HC-SR04 en cm)
 
-  if (now - previousReadMillis >= READ_INTERVAL) {
+// Solo se usa para dimensionar ventanas de escucha en compilación.
 
-    previousReadMillis = now;
+#define DURATION_TO_CM_DIVISOR 58
 
   
 
-    // Lecturas de sensores (optimizadas)
+// — Conversión sin división: d_q8 = (duration * factor) >> 12 —
 
-    uint8_t z1 = read_distance(TRIG1, ECHO1);
+// factor = c(T) / 20000 * 256 * 4096, con c(T) = 331.3 + 0.606·T m/s.
 
-    uint8_t z2 = read_distance(TRIG2, ECHO2);
+// Tabla en PROGMEM generada en compilación, de -10 °C a 40 °C cada 5 °C;
 
-    // Actualización Kalman y registro histórico (en enteros)
+// duration * factor cabe en 32 bits hasta 65 ms de eco.
 
-    uint8_t estimate = update_kalman(z1, z2);
+#define ECHO_FACTOR_SHIFT 12
 
-    estimationHistory[historyIndex] = estimate;
+#define SOUND_TEMP_MIN -10
 
-    historyIndex = (historyIndex + 1) % HISTORY_SIZE;
+#define SOUND_TEMP_STEP 5
 
-    // Calcular variación histórica (optimizada para enteros)
+#define SOUND_TEMP_COUNT 11
 
-    uint8_t variation = calculate_history_variation();
+#define AMBIENT_TEMP 20  // °C al arrancar
 
   
 
-    #ifdef DEBUG
+constexpr uint16_t echo_factor(int8_t celsius) {
+
+  // (331300 + 606·T) mm/s * 2^20 / 2e7 -> redondeado al entero más cercano
 
-      Serial.print(F("z1:"));  Serial.print(z1);
+  return (uint16_t)(((331300LL + 606LL * celsius) * 65536LL + 625000LL) / 1250000LL);
 
-      Serial.print(F(" z2:")); Serial.print(z2);
+}
+
+  
 
-      Serial.print(F(" K:"));  Serial.print(estimate);
+const uint16_t ECHO_FACTOR_TABLE[SOUND_TEMP_COUNT] PROGMEM = {
 
-      Serial.print(F(" P:"));  Serial.print(kalman_p_x10);
+  echo_factor(-10), echo_factor(-5), echo_factor(0),  echo_factor(5),
 
-      Serial.print(F(" V:"));  Serial.print(variation);
+  echo_factor(10),  echo_factor(15), echo_factor(20), echo_factor(25),
 
-    #endif
+  echo_factor(30),  echo_factor(35), echo_factor(40)
+
+};
+
+uint16_t echoFactor = echo_factor(AMBIENT_TEMP);
 
   
 
-    // — Condiciones de activación (optimizadas) —
+// — Tiempo máximo de espera para echo en microsegundos —
 
-    bool allValid = true;
+// 25000 μs corresponde a ~4.3m (máximo teórico HC-SR04)
 
-    for (uint8_t i = 0; i < HISTORY_SIZE; i++) {
+#define ECHO_TIMEOUT 25000
 
-      if (estimationHistory[i] > SAFE_MAX_DIST) {
+  
 
-        allValid = false;
+// — Ventana de escucha limitada al alcance (range gating) —
 
-        break;
+// Con RANGE_GATING cada sensor solo espera el eco hasta su alcance
 
-      }
+// configurado (+ margen) en lugar de los 4.3 m del ECHO_TIMEOUT; con el
 
-    }
+// seguimiento enganchado la ventana se reduce a la estimación + TRACK_GATE.
+
+// NO_RANGE_GATING lo quita al compilar una prueba de PC (prueba_eco.cpp).
+
+#ifndef NO_RANGE_GATING
+
+#define RANGE_GATING
 
-    // Evaluación de estabilidad y certidumbre (optimizada)
+#endif
 
-    bool stable = (variation <= STABLE_THRESHOLD_X10);
+#define ECHO_RISE_LATENCY_US 500  // disparo -> flanco de subida del HC-SR04
 
-    bool lowUncert = (kalman_p_x10 < UNCERT_THRESHOLD_X10);
+#define RANGE_GATE_MARGIN 8       // cm extra sobre el alcance configurado
+
+#define TRACK_GATE 15             // cm por encima de la estimación con seguimiento
+
+#define ECHO_WINDOW_US(cm) ((uint16_t)(ECHO_RISE_LATENCY_US + ((uint16_t)(cm) + RANGE_GATE_MARGIN) * DURATION_TO_CM_DIVISOR))
 
   
 
-    // Lógica de activación (simplificada y optimizada)
+// — Sensores: lista de pines en compilación —
 
-    // if (estimate >= MIN_DIST && estimate <= SAFE_MAX_DIST &&
+// Añadir un sensor es añadir una entrada; todo lo demás se dimensiona con N.
 
-    if (estimate >= ACTIVATION_MIN && estimate <= SAFE_MAX_DIST &&
+// Con N = 2 el código no es más pequeño que con las macros TRIG1/ECHO1/...
 
-        allValid && stable && lowUncert &&
+// de antes: en el PC (banco_sensores.cpp, -Os) 2219 bytes frente a 2019,
 
-        currentLedState == LED_OFF) {
+// un 10 % más, aunque loop() es más rápida (15 frente a 18 ns). En el AVR
 
-      // Verificación adicional con al menos una lectura válida
+// falta medirlo con avr-size.
 
-      if ((z1 > 0 && z1 <= SAFE_MAX_DIST) || (z2 > 0 && z2 <= SAFE_MAX_DIST)) {
+struct SensorConfig {
 
-        #ifdef DEBUG
+  uint8_t trig;
 
-          Serial.println(F(" -> ACTIVANDO"));
+  uint8_t echo;
 
-        #endif
+  uint8_t maxRange;  // cm, alcance usado para la ventana de escucha
 
-        digitalWrite(LED_PIN, HIGH);
+};
 
-        digitalWrite(LED_INDICATOR, HIGH);
+const SensorConfig SENSOR_PINS[] = {
 
-        currentLedState = LED_ON;
+  {11, 12, MAX_DIST},  // sensor 1
 
-        ledStartMillis = now;
+  {3, 4, MAX_DIST}     // sensor 2
 
-      }
+};
 
-    }
+#define NUM_SENSORS (sizeof(SENSOR_PINS) / sizeof(SENSOR_PINS[0]))
 
-    #ifdef DEBUG
+  
 
-      else {
+// — Captura de eco por interrupción (pin-change) —
 
-        // Mensajes de depuración omitidos en versión de producción
+// El ISR registra los flancos de subida/bajada de cada ECHO con micros()
 
-        if (estimate > SAFE_MAX_DIST)
+// y deja la duración lista para loop(), que nunca se bloquea en pulseIn().
 
-          Serial.println(F(" -> FUERA RANGO"));
+#define ECHO_IDLE 0   // sin medición pendiente
 
-        else if (!allValid)
+#define ECHO_ARMED 1  // disparado, esperando flanco de subida
 
-          Serial.println(F(" -> HIST NO VALIDO"));
+#define ECHO_HIGH 2   // flanco de subida registrado, esperando bajada
 
-        else if (!stable)
+#define ECHO_DONE 3   // duración disponible
 
-          Serial.println(F(" -> INESTABLE"));
+  
 
-        else if (!lowUncert)
+// — Planificación de disparos —
 
-          Serial.println(F(" -> INCERTIDUMBRE"));
+// Escalonado (por defecto): cada TRIG se dispara TRIGGER_STAGGER_US después
 
-        else if (currentLedState != LED_OFF)
+// del anterior y todos los ecos se escuchan en una sola ventana. El pulso
 
-          Serial.println(F(" -> EN CICLO"));
+// de un sensor, rebotado en el mismo objeto, llega al de al lado a lo
 
-        else
+// sumo SENSOR_SPACING_CM de camino después que a él: si un eco termina a
 
-          Serial.println(F(" -> BAJO RANGO"));
+// menos de CROSSTALK_WINDOW_US del de un sensor disparado antes, y con su
 
-      }
+// ECHO ya alto, ese sensor oyó el pulso ajeno y su lectura se descarta.
 
-      if (z1 == 0 && z2 == 0) {
+// El desfase es el doble de esa ventana: el eco propio del mismo objeto
 
-        Serial.println(F(" -> SIN LECTURA"));
+// llega TRIGGER_STAGGER_US después del ajeno y no se confunde con él; solo
 
-      }
+// un objeto propio ~STAGGER/58 cm más cerca que el del otro cae en la
 
-    #endif
+// ventana. Con SCHEDULE_ROUND_ROBIN se dispara un solo sensor por ciclo.
 
-  }
+//#define SCHEDULE_ROUND_ROBIN
+
+#define SENSOR_SPACING_CM 10  // entre sensores vecinos (medir en el montaje)
+
+#define CROSSTALK_WINDOW_US (SENSOR_SPACING_CM * DURATION_TO_CM_DIVISOR / 2)
+
+#define TRIGGER_STAGGER_US (2 * CROSSTALK_WINDOW_US)
 
   
 
-  // — Control ciclo LED (optimizado) —
+// — Estados de la adquisición no bloqueante —
 
-  if (currentLedState == LED_ON && now - ledStartMillis >= LED_ON_DURATION) {
+#define ACQ_IDLE 0
 
-    digitalWrite(LED_PIN, LOW);
+#define ACQ_STAGGER 1  // disparando sensores con desfase
 
-    digitalWrite(LED_INDICATOR, LOW);
+#define ACQ_LISTEN 2   // todos disparados, esperando ecos
 
-    currentLedState = LED_WAIT_OFF;
+bool trackingLocked = false;  // estimación estable y con baja incertidumbre
 
-    ledStartMillis = now;
+  
 
-    #ifdef DEBUG
+#ifdef KALMAN_REPLAY
 
-      Serial.println(F("LED OFF - ESPERA"));
+// Sustituto sin hardware: las lecturas vienen de la captura y solo queda
 
-    #endif
+// el estado habilitado de cada sensor (disparo escalonado: fired = enabled)
 
-  }
+template <uint8_t N, const SensorConfig (&Config)[N]>
 
-  else if (currentLedState == LED_WAIT_OFF && now - ledStartMillis >= LED_OFF_DURATION) {
+class SensorArray {
 
-    currentLedState = LED_OFF;
+public:
 
-    #ifdef DEBUG
+  SensorArray() { for (uint8_t i = 0; i < N; i++) enabled[i] = true; }
 
-      Serial.println(F("LISTO NUEVA ACTIVACION"));
+  void set_track_gate(uint8_t) {}
 
-    #endif
+  bool fired(uint8_t i) { return enabled[i]; }
 
-  }
+  void set_enabled(uint8_t i, bool on) { enabled[i] = on; }
 
-}
+private:
+
+  bool enabled[N];
+
+};
+
+#else
+
+template <uint8_t N, const SensorConfig (&Config)[N]>
+
+class SensorArray {
+
+public:
+
+  void begin();
+
+  bool update(unsigned long now);           // true con un ciclo completo
+
+  unsigned long echo_duration(uint8_t i);   // μs, 0 si no hubo eco
+
+  void set_track_gate(uint8_t gateCm) { trackGate = gateCm; }
+
+  bool fired(uint8_t i);                    // disparado en el último ciclo
+
+  void set_enabled(uint8_t i, bool on) { enabled[i] = on; }  // fuera del ciclo si false
+
+  void capture_edges();                     // llamado desde los ISR
+
+private:
+
+  void trigger(uint8_t i);
+
+  bool poll(uint8_t i);
+
+  uint8_t next_enabled(uint8_t from);
+
+  void reject_crosstalk();
+
+  void update_range_gate();
 
   
 
-// -------------------- Funciones Auxiliares (Optimizadas) --------------------
+  volatile uint8_t *inputReg[N];  // registro PINx de cada ECHO
+
+  uint8_t bitMask[N];
+
+  volatile uint8_t state[N];
+
+  volatile unsigned long riseMicros[N];
+
+  volatile unsigned long fallMicros[N];
+
+  volatile unsigned long duration[N];
+
+  unsigned long triggerMicros[N];
+
+  uint16_t window[N];             // ventana de escucha activa (μs)
+
+  bool enabled[N];                // deshabilitado: ni disparo ni espera de eco
+
+  uint8_t acqState = ACQ_IDLE;
+
+  uint8_t nextSensor = 0;
+
+  uint8_t lastTriggered = N;      // N: ninguno en este ciclo
+
+  uint8_t trackGate = 0;          // cm, 0 sin seguimiento
+
+};
+
+#endif
 
   
 
-// Función de lectura de distancia optimizada para enteros
+SensorArray<NUM_SENSORS, SENSOR_PINS> sensors;
 
-uint8_t read_distance(uint8_t trigPin, uint8_t echoPin) {
+// — Instancias del filtro (kalman.h) —
 
-  // Secuencia de disparo optimizada
+// 1D y CV: estado y covarianzas Q16.16. KALMAN_X10: estado Q8.8 y
 
-  digitalWrite(trigPin, LOW);
+// covarianzas en décimas (Tenths), el cálculo entero original.
 
-  delayMicroseconds(2);
+#ifdef KALMAN_GAIN_TABLE
 
-  digitalWrite(trigPin, HIGH);
+typedef TenthsTable KalmanTenths;
 
-  delayMicroseconds(10);
+#else
 
-  digitalWrite(trigPin, LOW);
+typedef Tenths KalmanTenths;
 
-  // Lectura de duración con timeout
+#endif
 
-  unsigned long duration = pulseIn(echoPin, HIGH, ECHO_TIMEOUT);
+#ifdef KALMAN_CV
 
-  // Validación y conversión a distancia (en cm)
+typedef KalmanFilter<Q16, 2, NUM_SENSORS> KalmanType;
 
-  if (duration == 0) return 0;  // Sin eco válido
+KalmanType kalman_initial() {
 
-  // Conversión optimizada a centímetros (uint8_t)
+  return KalmanType((int32_t)kalman_x0 << 8, Q16{Q16_ONE}, Q16{CV_P11_0},
 
-  uint8_t d = duration / DURATION_TO_CM_DIVISOR;
+                    Q16{CV_DT_Q16}, Q16{CV_Q00}, Q16{CV_Q01}, Q16{CV_Q11});
 
-  // Detección de zona difusa (optimizada)
+}
 
-  if (d > DIFFUSE_ZONE_START && d < DIFFUSE_ZONE_END) {
+#elif defined(KALMAN_X10)
 
-    #ifdef DEBUG
+typedef KalmanFilter<KalmanTenths, 1, NUM_SENSORS> KalmanType;
 
-      Serial.print(F("DIFUSA:")); Serial.println(d);
+KalmanType kalman_initial() {
 
-    #endif
+  return KalmanType(kalman_x0, KalmanTenths{kalman_p0_x10},
 
-    return MAX_DIST + 1;  // Fuera de rango
+                    KalmanTenths{(uint8_t)((kalman_q0_x100 + 9) / 10)});  // q_x100 a décimas, hacia arriba
 
-  }
+}
 
-  // Restricción a rango útil
+#else
 
-  if (d < MIN_DIST) return MIN_DIST;
+typedef KalmanFilter<Q16, 1, NUM_SENSORS> KalmanType;
 
-  if (d > MAX_DIST) return MAX_DIST;
+KalmanType kalman_initial() {
 
-  return d;
+  return KalmanType((int32_t)kalman_x0 << 8, Q16{kalman_p0_x10 * Q16_ONE / 10},
+
+                    Q16{(int32_t)(kalman_q0_x100 * Q16_ONE / 100)});
 
 }
 
+#endif
+
+KalmanType kalman = kalman_initial();
+
+KalmanTenths kalman_r[NUM_SENSORS];  // ruido de medición de cada sensor x10
+
+#if defined(NOISE_ESTIMATION) && !defined(KALMAN_X10) && !defined(KALMAN_CV)
+
+Q16 noiseR[NUM_SENSORS];  // R estimado de cada sensor sin cuantizar (Q16.16)
+
+#endif
+
   
 
-// Filtro Kalman optimizado para enteros con escalado para mantener precisión
+// — Pre-filtro de mediana por sensor (entre read_distance y el Kalman) —
 
-uint8_t update_kalman(uint8_t z1, uint8_t z2) {
+// Mediana móvil de 3 lecturas en un anillo fijo: un eco aislado erróneo
 
-  // — Predicción (trabajando con valores escalados) —
+// (multitrayecto, marca de zona difusa) no llega a update_kalman() ni infla
 
-  kalman_p_x10 += (kalman_q_x100 / 10);  // q_x100/10 para mantener escala x10
+// kalman_p; un cambio real pasa con una lectura de retraso. Con el anillo
 
-  // — Actualización con z1 (si válido) —
+// sin ecos (al arrancar o tras irse el objeto) la primera lectura con eco
 
-  if (z1 > 0) {
+// lo llena entero.
 
-    // Cálculo de ganancia Kalman optimizado
+// NO_MEDIAN_PREFILTER lo quita al compilar una prueba de PC (prueba_mediana.cpp).
 
-    uint16_t denominator = kalman_p_x10 + kalman_r1_x10;
+#ifndef NO_MEDIAN_PREFILTER
 
-    uint8_t k_x10 = (denominator > 0) ? ((10 * kalman_p_x10) / denominator) : 0;
+#define MEDIAN_PREFILTER
 
-    // Actualización de estado optimizada para evitar desbordamiento
+#endif
 
-    int16_t innovation = ((int16_t)z1 - (int16_t)kalman_x);
+#ifdef MEDIAN_PREFILTER
 
-    kalman_x += (k_x10 * innovation) / 10;
+#define MEDIAN_WINDOW 3  // median_prefilter() está escrita para 3
 
-    // Actualización de covarianza optimizada
+uint16_t medianRing[NUM_SENSORS][MEDIAN_WINDOW];
 
-    kalman_p_x10 = (kalman_p_x10 * (10 - k_x10)) / 10;
+uint8_t medianIndex[NUM_SENSORS];
 
-  }
+#endif
+
+  
 
-  // — Actualización con z2 (si válido) —
+// — Compuerta de innovación y salud de cada sensor —
 
-  if (z2 > 0) {
+// Con INNOVATION_GATING una lectura se descarta antes de tocar el estado
 
-    // Mismo proceso para z2
+// si su innovación normalizada e² / (P + R) supera NIS_GATE (χ² con 1
 
-    uint16_t denominator = kalman_p_x10 + kalman_r2_x10;
+// grado de libertad). Si todas las lecturas se rechazan NIS_REACQUIRE
 
-    uint8_t k_x10 = (denominator > 0) ? ((10 * kalman_p_x10) / denominator) : 0;
+// ciclos seguidos el objeto cambió de verdad: se infla P y se re-adquiere.
 
-    int16_t innovation = ((int16_t)z2 - (int16_t)kalman_x);
+// Al arrancar (y en CV al perder el objeto) el estado inicial no es una
 
-    kalman_x += (k_x10 * innovation) / 10;
+// estimación: la compuerta no se arma hasta la primera lectura, que se
 
-    kalman_p_x10 = (kalman_p_x10 * (10 - k_x10)) / 10;
+// adquiere con P inflada en vez de rechazarse contra kalman_x0.
 
-  }
+// Cada sensor lleva su salud: rechazos o ecos perdidos (cuando otro sensor
 
-  // — Ajuste dinámico de ruido de medición (simplificado y optimizado) —
+// sí ve el objeto) seguidos lo pasan a SOSPECHOSO y luego a FALLADO, que
 
-  if (z1 > 0 && z2 > 0) {
+// lo saca del ciclo de adquisición (ni disparo ni espera de eco) y se
 
-    uint8_t diff = (z1 > z2) ? (z1 - z2) : (z2 - z1);
+// vuelve a probar cada HEALTH_RETRY_MS. Una lectura aceptada lo devuelve a OK.
 
-    if (diff > 1) {
+// NO_INNOVATION_GATING quita la compuerta al compilar una prueba de PC
 
-      // Aumentar ruido (sensores discrepan)
+// (prueba_fallos.cpp); la salud sigue contando los ecos perdidos.
 
-      if (kalman_r1_x10 < 20) kalman_r1_x10++;  // Máximo 2.0
+#ifndef NO_INNOVATION_GATING
 
-      if (kalman_r2_x10 < 20) kalman_r2_x10++;
+#define INNOVATION_GATING
 
-    } else {
+#endif
 
-      // Disminuir ruido (sensores concuerdan)
+#define NIS_GATE 9              // 3σ: p ≈ 0.27 % de rechazar una lectura buena
 
-      if (kalman_r1_x10 > 1) kalman_r1_x10--;  // Mínimo 0.1
+#define NIS_REACQUIRE 5         // ciclos con todo rechazado antes de re-adquirir
 
-      if (kalman_r2_x10 > 1) kalman_r2_x10--;
+#define HEALTH_SUSPECT 3        // fallos seguidos -> SOSPECHOSO
 
-    }
+#define HEALTH_FAILED 25        // fallos seguidos -> FALLADO (fuera del ciclo)
 
-  }
+#define HEALTH_RETRY_MS 1000    // reintento de un sensor FALLADO
 
-  // — Restricción del estado estimado —
+  
+
+// Estados de salud
 
-  if (kalman_x < MIN_DIST) kalman_x = MIN_DIST;
+#define SENSOR_OK 0
 
-  if (kalman_x > MAX_DIST) kalman_x = MAX_DIST;
+#define SENSOR_SUSPECT 1
 
-  // — Reset q —
+#define SENSOR_FAILED 2
 
-  kalman_q_x100 = kalman_q0_x100;
+  
 
-  return kalman_x;
+uint8_t sensorHealth[NUM_SENSORS];       // SENSOR_OK al arrancar
 
-}
+uint8_t sensorFaults[NUM_SENSORS];       // fallos seguidos
+
+unsigned long sensorFailedMillis[NUM_SENSORS];
+
+bool innovationRejected[NUM_SENSORS];    // rechazada en este ciclo
+
+uint8_t rejectStreak = 0;                // ciclos con todas las lecturas rechazadas
+
+bool gateArmed = false;                  // hay estimación que defender (primera lectura ya aceptada)
 
   
 
-// Cálculo de variación en historial optimizado para enteros
+// — Declaraciones de funciones —
 
-uint8_t calculate_history_variation() {
+uint16_t read_distance(uint8_t sensor);
 
-  uint8_t max_val = 0, min_val = 255;
+#ifdef MEDIAN_PREFILTER
 
-  for (uint8_t i = 0; i < HISTORY_SIZE; i++) {
+uint16_t median_prefilter(uint8_t sensor, uint16_t z);
 
-    uint8_t val = estimationHistory[i];
+#endif
 
-    if (val == 0) continue;  // Ignorar valores no inicializados
+void kalman_init();
 
-    if (val > max_val) max_val = val;
+void process_cycle(const uint16_t z[NUM_SENSORS], unsigned long now);
 
-    if (val < min_val) min_val = val;
+void update_led_cycle(unsigned long now);
 
-  }
+uint16_t update_kalman(const uint16_t z[NUM_SENSORS]);
+
+uint16_t update_kalman_cv(const uint16_t z[NUM_SENSORS]);
+
+void adapt_measurement_noise(const uint16_t z[NUM_SENSORS]);
+
+void measurements_q16(const uint16_t z[NUM_SENSORS], int32_t zq[NUM_SENSORS], Q16 r[NUM_SENSORS]);
+
+void estimate_measurement_noise(const int32_t zq[NUM_SENSORS], int32_t x, Q16 p, Q16 r[NUM_SENSORS]);
+
+void estimate_process_noise(int32_t dx, Q16 p_prev);
+
+bool gate_innovations(int32_t zq[NUM_SENSORS], int32_t x, Q16 p, const Q16 r[NUM_SENSORS]);
+
+void kalman_reacquire();
+
+void update_sensor_health(const uint16_t z[NUM_SENSORS], unsigned long now);
+
+uint16_t kalman_position();
+
+uint8_t kalman_p_x10();
+
+uint16_t cv_motion_allowance();
+
+long cv_time_to_contact_ms();
+
+uint16_t calculate_history_variation();
+
+void print_q8(uint16_t value);
+
+void set_sound_temperature(int8_t celsius);
+
+unsigned long echo_to_q8(unsigned long duration);
+
+  
+
+#ifndef KALMAN_REPLAY
+
+void setup() {
+
+  // Configuración de pines optimizada (escritura directa a registros)
+
+  sensors.begin();
+
+  pinMode(LED_PIN, OUTPUT);
+
+  pinMode(LED_INDICATOR, OUTPUT);
+
+  
+
+  digitalWrite(LED_PIN, LOW);
+
+  digitalWrite(LED_INDICATOR, LOW);
+
+  
+
+  kalman_init();
+
+  set_sound_temperature(AMBIENT_TEMP);
+
+  
+
+  #ifdef DEBUG
+
+    Serial.begin(9600);
+
+    Serial.println(F("SISTEMA INICIADO - OPTIMIZADO"));
+
+  #endif
+
+}
+
+  
+
+void loop() {
+
+  unsigned long now = millis();
+
+  
+
+  // — Lectura y filtro cada READ_INTERVAL ms (la captura corre en segundo plano) —
+
+  if (sensors.update(now)) {
+
+    // Lecturas de sensores (duraciones ya capturadas por el ISR)
+
+    uint16_t z[NUM_SENSORS];
+
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+
+      z[i] = read_distance(i);
+
+      #ifdef MEDIAN_PREFILTER
+
+        if (sensors.fired(i)) z[i] = median_prefilter(i, z[i]);
+
+      #endif
+
+    }
+
+    process_cycle(z, now);
+
+  }
+
+  update_led_cycle(now);
+
+}
+
+#endif
+
+  
+
+// Un ciclo completo con las lecturas z (Q8.8, 0 sin eco): Kalman,
+
+// historial y activación. loop() lo llama con lecturas recién capturadas
+
+// y afinador.cpp con las de una captura.
+
+void process_cycle(const uint16_t z[NUM_SENSORS], unsigned long now) {
+
+  // Actualización Kalman y registro histórico (en Q8.8)
+
+  #ifdef KALMAN_CV
+
+    uint16_t estimate = update_kalman_cv(z);  // posición proyectada
+
+  #else
+
+    uint16_t estimate = update_kalman(z);
+
+  #endif
+
+  update_sensor_health(z, now);
+
+  // Solo cuentan las lecturas aceptadas; la zona segura exige un sensor OK
+
+  bool anyReading = false;
+
+  bool anySafe = false;
+
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+
+    if (z[i] == 0 || innovationRejected[i]) continue;
+
+    anyReading = true;
+
+    if (z[i] <= SAFE_MAX_DIST_Q8 && sensorHealth[i] == SENSOR_OK) anySafe = true;
+
+  }
+
+  estimationHistory[historyIndex] = estimate;
+
+  historyIndex = (historyIndex + 1) % HISTORY_SIZE;
+
+  // Calcular variación histórica (optimizada para enteros)
+
+  uint16_t variation = calculate_history_variation();
+
+  
+
+  #ifdef DEBUG
+
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+
+      if (i > 0) Serial.print(' ');
+
+      Serial.print('z'); Serial.print(i + 1); Serial.print(':');
+
+      print_q8(z[i]);
+
+      if (innovationRejected[i]) Serial.print('!');
+
+    }
+
+    Serial.print(F(" K:"));  print_q8(estimate);
+
+    Serial.print(F(" P:"));  Serial.print(kalman_p_x10());
+
+    Serial.print(F(" V:"));  print_q8(variation);
+
+    #ifdef KALMAN_CV
+
+      Serial.print(F(" T:"));  Serial.print(cv_time_to_contact_ms());
+
+    #endif
+
+  #endif
+
+  
+
+  // — Condiciones de activación (optimizadas) —
+
+  bool allValid = true;
+
+  for (uint8_t i = 0; i < HISTORY_SIZE; i++) {
+
+    if (estimationHistory[i] > SAFE_MAX_DIST_Q8) {
+
+      allValid = false;
+
+      break;
+
+    }
+
+  }
+
+  // Evaluación de estabilidad y certidumbre (optimizada)
+
+  #ifdef KALMAN_CV
+
+    // En movimiento uniforme la dispersión esperada crece con |v|
+
+    bool stable = (variation <= STABLE_THRESHOLD_Q8 + cv_motion_allowance());
+
+  #else
+
+    bool stable = (variation <= STABLE_THRESHOLD_Q8);
+
+  #endif
+
+  bool lowUncert = (kalman_p_x10() < UNCERT_THRESHOLD_X10);
+
+  // Sin eco en ninguna ventana reducida: soltar el seguimiento
+
+  trackingLocked = stable && lowUncert && anyReading;
+
+  sensors.set_track_gate(trackingLocked ? (kalman_position() >> 8) + TRACK_GATE : 0);
+
+  
+
+  // Lógica de activación (simplificada y optimizada)
+
+  // if (estimate >= MIN_DIST_Q8 && estimate <= SAFE_MAX_DIST_Q8 &&
+
+  if (estimate >= ACTIVATION_MIN_Q8 && estimate <= SAFE_MAX_DIST_Q8 &&
+
+      allValid && stable && lowUncert &&
+
+      currentLedState == LED_OFF) {
+
+    // Verificación adicional con al menos una lectura válida
+
+    if (anySafe) {
+
+      #ifdef DEBUG
+
+        Serial.println(F(" -> ACTIVANDO"));
+
+      #endif
+
+      digitalWrite(LED_PIN, HIGH);
+
+      digitalWrite(LED_INDICATOR, HIGH);
+
+      currentLedState = LED_ON;
+
+      ledStartMillis = now;
+
+    }
+
+  }
+
+  #ifdef DEBUG
+
+    else {
+
+      // Mensajes de depuración omitidos en versión de producción
+
+      if (estimate > SAFE_MAX_DIST_Q8)
+
+        Serial.println(F(" -> FUERA RANGO"));
+
+      else if (!allValid)
+
+        Serial.println(F(" -> HIST NO VALIDO"));
+
+      else if (!stable)
+
+        Serial.println(F(" -> INESTABLE"));
+
+      else if (!lowUncert)
+
+        Serial.println(F(" -> INCERTIDUMBRE"));
+
+      else if (currentLedState != LED_OFF)
+
+        Serial.println(F(" -> EN CICLO"));
+
+      else
+
+        Serial.println(F(" -> BAJO RANGO"));
+
+    }
+
+    if (!anyReading) {
+
+      Serial.println(F(" -> SIN LECTURA"));
+
+    }
+
+  #endif
+
+}
+
+  
+
+// — Control ciclo LED (optimizado) —
+
+void update_led_cycle(unsigned long now) {
+
+  if (currentLedState == LED_ON && now - ledStartMillis >= LED_ON_DURATION) {
+
+    digitalWrite(LED_PIN, LOW);
+
+    digitalWrite(LED_INDICATOR, LOW);
+
+    currentLedState = LED_WAIT_OFF;
+
+    ledStartMillis = now;
+
+    #ifdef DEBUG
+
+      Serial.println(F("LED OFF - ESPERA"));
+
+    #endif
+
+  }
+
+  else if (currentLedState == LED_WAIT_OFF && now - ledStartMillis >= LED_OFF_DURATION) {
+
+    currentLedState = LED_OFF;
+
+    #ifdef DEBUG
+
+      Serial.println(F("LISTO NUEVA ACTIVACION"));
+
+    #endif
+
+  }
+
+}
+
+  
+
+// -------------------- Funciones Auxiliares (Optimizadas) --------------------
+
+  
+
+#ifndef KALMAN_REPLAY
+
+// Configuración de pines: registros de entrada y máscaras pin-change
+
+template <uint8_t N, const SensorConfig (&Config)[N]>
+
+void SensorArray<N, Config>::begin() {
+
+  for (uint8_t i = 0; i < N; i++) {
+
+    uint8_t pin = Config[i].echo;
+
+    pinMode(Config[i].trig, OUTPUT);
+
+    pinMode(pin, INPUT);
+
+    inputReg[i] = portInputRegister(digitalPinToPort(pin));
+
+    bitMask[i] = digitalPinToBitMask(pin);
+
+    state[i] = ECHO_IDLE;
+
+    enabled[i] = true;
+
+    *digitalPinToPCMSK(pin) |= bit(digitalPinToPCMSKbit(pin));
+
+    PCICR |= bit(digitalPinToPCICRbit(pin));
+
+  }
+
+}
+
+  
+
+// Rutina común a todos los vectores pin-change: marca tiempos de flanco
+
+template <uint8_t N, const SensorConfig (&Config)[N]>
+
+void SensorArray<N, Config>::capture_edges() {
+
+  unsigned long t = micros();
+
+  for (uint8_t i = 0; i < N; i++) {
+
+    bool level = (*inputReg[i] & bitMask[i]) != 0;
+
+    if (state[i] == ECHO_ARMED && level) {
+
+      riseMicros[i] = t;
+
+      state[i] = ECHO_HIGH;
+
+    } else if (state[i] == ECHO_HIGH && !level) {
+
+      fallMicros[i] = t;
+
+      duration[i] = t - riseMicros[i];
+
+      state[i] = ECHO_DONE;
+
+    }
+
+  }
+
+}
+
+  
+
+ISR(PCINT0_vect) { sensors.capture_edges(); }  // D8-D13
+
+ISR(PCINT1_vect) { sensors.capture_edges(); }  // A0-A5
+
+ISR(PCINT2_vect) { sensors.capture_edges(); }  // D0-D7
+
+  
+
+// Pulso de disparo; la medición queda armada para el ISR
+
+template <uint8_t N, const SensorConfig (&Config)[N]>
+
+void SensorArray<N, Config>::trigger(uint8_t i) {
+
+  uint8_t trigPin = Config[i].trig;
+
+  noInterrupts();
+
+  duration[i] = 0;
+
+  // Si el ECHO sigue alto (eco anterior sin retorno) el módulo no
+
+  // acepta un nuevo disparo: la lectura se da por perdida.
+
+  state[i] = (*inputReg[i] & bitMask[i]) ? ECHO_DONE : ECHO_ARMED;
+
+  interrupts();
+
+  triggerMicros[i] = micros();
+
+  digitalWrite(trigPin, LOW);
+
+  delayMicroseconds(2);
+
+  digitalWrite(trigPin, HIGH);
+
+  delayMicroseconds(10);
+
+  digitalWrite(trigPin, LOW);
+
+}
+
+  
+
+// true cuando la medición terminó (eco recibido o timeout)
+
+template <uint8_t N, const SensorConfig (&Config)[N]>
+
+bool SensorArray<N, Config>::poll(uint8_t i) {
+
+  if (state[i] == ECHO_DONE) return true;
+
+  if (micros() - triggerMicros[i] < window[i]) return false;
+
+  // Fin de la ventana de escucha: sin eco válido. Si el ECHO sigue alto,
+
+  // el siguiente disparo de este sensor se pierde (ver trigger).
+
+  noInterrupts();
+
+  if (state[i] != ECHO_DONE) {
+
+    duration[i] = 0;
+
+    state[i] = ECHO_DONE;
+
+  }
+
+  interrupts();
+
+  return true;
+
+}
+
+  
+
+// Avanza la adquisición; true cuando hay lecturas nuevas de todos los sensores
+
+template <uint8_t N, const SensorConfig (&Config)[N]>
+
+bool SensorArray<N, Config>::update(unsigned long now) {
+
+  switch (acqState) {
+
+    case ACQ_IDLE:
+
+      if (now - previousReadMillis >= READ_INTERVAL) {
+
+        previousReadMillis = now;
+
+        update_range_gate();
+
+        // Los sensores deshabilitados quedan sin lectura y sin ventana de escucha
+
+        for (uint8_t i = 0; i < N; i++) {
+
+          duration[i] = 0;
+
+          state[i] = ECHO_DONE;
+
+        }
+
+        lastTriggered = N;
+
+        #ifdef SCHEDULE_ROUND_ROBIN
+
+          // Solo un sensor por ciclo: los demás quedan sin lectura
+
+          for (uint8_t k = 0; k < N; k++) {
+
+            uint8_t i = (nextSensor + k) % N;
+
+            if (!enabled[i]) continue;
+
+            trigger(i);
+
+            lastTriggered = i;
+
+            nextSensor = (i + 1) % N;
+
+            break;
+
+          }
+
+          acqState = ACQ_LISTEN;
+
+        #else
+
+          nextSensor = next_enabled(0);
+
+          if (nextSensor < N) {
+
+            trigger(nextSensor);
+
+            lastTriggered = nextSensor;
+
+            nextSensor = next_enabled(nextSensor + 1);
+
+          }
+
+          acqState = (nextSensor < N) ? ACQ_STAGGER : ACQ_LISTEN;
+
+        #endif
+
+      }
+
+      break;
+
+    case ACQ_STAGGER:
+
+      if (micros() - triggerMicros[lastTriggered] >= TRIGGER_STAGGER_US) {
+
+        trigger(nextSensor);
+
+        lastTriggered = nextSensor;
+
+        nextSensor = next_enabled(nextSensor + 1);
+
+        if (nextSensor == N) acqState = ACQ_LISTEN;
+
+      }
+
+      break;
+
+    case ACQ_LISTEN:
+
+      // Evaluar todos para que los timeouts se resuelvan en este ciclo
+
+      bool done = true;
+
+      for (uint8_t i = 0; i < N; i++) {
+
+        if (!poll(i)) done = false;
+
+      }
+
+      if (done) {
+
+        reject_crosstalk();
+
+        acqState = ACQ_IDLE;
+
+        return true;
+
+      }
+
+      break;
+
+  }
+
+  return false;
+
+}
+
+  
+
+// Ventana de escucha de cada sensor para el ciclo que empieza
+
+template <uint8_t N, const SensorConfig (&Config)[N]>
+
+void SensorArray<N, Config>::update_range_gate() {
+
+  for (uint8_t i = 0; i < N; i++) {
+
+    #ifdef RANGE_GATING
+
+      window[i] = ECHO_WINDOW_US(Config[i].maxRange);
+
+      if (trackGate > 0) {
+
+        uint16_t tracked = ECHO_WINDOW_US(trackGate);
+
+        if (tracked < window[i]) window[i] = tracked;
+
+      }
+
+    #else
+
+      window[i] = ECHO_TIMEOUT;
+
+    #endif
+
+  }
+
+}
+
+  
+
+// Descarta ecos que terminan junto con el de un sensor disparado antes,
+
+// si ese eco llegó con el ECHO propio ya alto (el camino cruzado)
+
+template <uint8_t N, const SensorConfig (&Config)[N]>
+
+void SensorArray<N, Config>::reject_crosstalk() {
+
+  for (uint8_t j = 1; j < N; j++) {
+
+    if (duration[j] == 0) continue;
+
+    for (uint8_t i = 0; i < j; i++) {
+
+      if (duration[i] == 0) continue;
+
+      if ((long)(fallMicros[i] - riseMicros[j]) < 0) continue;  // j aún no escuchaba
+
+      long gap = (long)(fallMicros[j] - fallMicros[i]);
+
+      if (gap < 0) gap = -gap;
+
+      if (gap < CROSSTALK_WINDOW_US) {
+
+        #ifdef DEBUG
+
+          Serial.print(F("CRUCE:")); Serial.println(gap);
+
+        #endif
+
+        duration[j] = 0;  // Sin eco válido propio
+
+        break;
+
+      }
+
+    }
+
+  }
+
+}
+
+  
+
+// En round-robin solo el último sensor disparado tiene lectura propia
+
+template <uint8_t N, const SensorConfig (&Config)[N]>
+
+bool SensorArray<N, Config>::fired(uint8_t i) {
+
+  #ifdef SCHEDULE_ROUND_ROBIN
+
+    return i == lastTriggered;
+
+  #else
+
+    return enabled[i];
+
+  #endif
+
+}
+
+  
+
+// Primer sensor habilitado desde from (N si no queda ninguno)
+
+template <uint8_t N, const SensorConfig (&Config)[N]>
+
+uint8_t SensorArray<N, Config>::next_enabled(uint8_t from) {
+
+  while (from < N && !enabled[from]) from++;
+
+  return from;
+
+}
+
+  
+
+// Duración capturada (lectura atómica frente al ISR)
+
+template <uint8_t N, const SensorConfig (&Config)[N]>
+
+unsigned long SensorArray<N, Config>::echo_duration(uint8_t i) {
+
+  noInterrupts();
+
+  unsigned long d = duration[i];
+
+  interrupts();
+
+  return (d > window[i]) ? 0 : d;
+
+}
+
+  
+
+// Conversión de la duración capturada a distancia en Q8.8
+
+uint16_t read_distance(uint8_t sensor) {
+
+  unsigned long duration = sensors.echo_duration(sensor);
+
+  // Validación y conversión a distancia (en cm)
+
+  if (duration == 0) return 0;  // Sin eco válido
+
+  unsigned long d = echo_to_q8(duration);
+
+  // Detección de zona difusa (optimizada)
+
+  if (d > CM_Q8(DIFFUSE_ZONE_START) && d < CM_Q8(DIFFUSE_ZONE_END)) {
+
+    #ifdef DEBUG
+
+      Serial.print(F("DIFUSA:")); print_q8(d); Serial.println();
+
+    #endif
+
+    return OUT_OF_RANGE_Q8;  // Fuera de rango
+
+  }
+
+  // Restricción a rango útil
+
+  if (d < MIN_DIST_Q8) return MIN_DIST_Q8;
+
+  if (d > MAX_DIST_Q8) return MAX_DIST_Q8;
+
+  return d;
+
+}
+
+  
+
+#endif
+
+  
+
+#ifdef MEDIAN_PREFILTER
+
+// Mediana de las últimas MEDIAN_WINDOW lecturas del sensor (0 = sin eco)
+
+uint16_t median_prefilter(uint8_t sensor, uint16_t z) {
+
+  uint16_t *ring = medianRing[sensor];
+
+  // Anillo sin ecos: la lectura pasa tal cual y, si es un eco (la marca de
+
+  // zona difusa no cuenta), lo llena. Si no, las dos medianas siguientes
+
+  // serían contra ceros y el objeto llegaría dos lecturas tarde
+
+  if ((ring[0] | ring[1] | ring[2]) == 0) {
+
+    if (z == 0 || z >= OUT_OF_RANGE_Q8) return z;
+
+    for (uint8_t k = 0; k < MEDIAN_WINDOW; k++) ring[k] = z;
+
+    return z;
+
+  }
+
+  ring[medianIndex[sensor]] = z;
+
+  medianIndex[sensor] = (medianIndex[sensor] + 1) % MEDIAN_WINDOW;
+
+  // Mediana de 3 con tres comparaciones: max(a, min(b, c)) con a <= b
+
+  uint16_t a = ring[0], b = ring[1], c = ring[2];
+
+  if (a > b) { uint16_t t = a; a = b; b = t; }
+
+  if (b > c) b = c;
+
+  return (a > b) ? a : b;
+
+}
+
+#endif
+
+  
+
+// Estado inicial del filtro y ruido inicial de cada sensor
+
+void kalman_init() {
+
+  kalman = kalman_initial();
+
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) kalman_r[i].v = kalman_r0_x10;
+
+  gateArmed = false;
+
+  rejectStreak = 0;
+
+  #ifdef MEDIAN_PREFILTER
+
+    for (uint8_t i = 0; i < NUM_SENSORS; i++)
+
+      for (uint8_t k = 0; k < MEDIAN_WINDOW; k++) medianRing[i][k] = 0;
+
+  #endif
+
+  #if defined(NOISE_ESTIMATION) && !defined(KALMAN_X10) && !defined(KALMAN_CV)
+
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) noiseR[i].v = kalman_r0_x10 * (Q16_ONE / 10);
+
+  #endif
+
+}
+
+  
+
+#if defined(KALMAN_X10) && !defined(KALMAN_CV)
+
+// Posición filtrada en Q8.8 e incertidumbre x10
+
+uint16_t kalman_position() { return kalman.x; }
+
+  
+
+uint8_t kalman_p_x10() { return kalman.p.v; }
+
+  
+
+// Filtro Kalman optimizado para enteros con escalado para mantener precisión
+
+uint16_t update_kalman(const uint16_t z[NUM_SENSORS]) {
+
+  kalman.predict();
+
+  // — Compuerta de innovación (en Q16.16); za son las lecturas aceptadas —
+
+  int32_t zq[NUM_SENSORS];
+
+  Q16 r[NUM_SENSORS];
+
+  measurements_q16(z, zq, r);
+
+  Q16 p = {kalman.p.v * (int32_t)(Q16_ONE / 10)};
+
+  bool reacquire = gate_innovations(zq, (int32_t)kalman.x << 8, p, r);
+
+  uint16_t za[NUM_SENSORS];  // tras la compuerta: sin las rechazadas
+
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) za[i] = zq[i] >> 8;
+
+  if (reacquire) {
+
+    // K en décimas no pasa de 9/10: la primera lectura fija el estado
+
+    kalman_reacquire();
+
+    for (uint8_t i = NUM_SENSORS; i-- > 0;) if (za[i] > 0) kalman.x = za[i];
+
+  }
+
+  #ifdef KALMAN_FUSED
+
+    // — Fusión de todas las lecturas válidas en un solo paso —
+
+    uint16_t w[NUM_SENSORS];
+
+    for (uint8_t i = 0; i < NUM_SENSORS; i++)
+
+      w[i] = pgm_read_word(&INFO_Q12_TABLE[kalman_r[i].v]);
+
+    kalman.update_fused(za, w);
+
+  #else
+
+    // — Actualización secuencial con cada lectura válida —
+
+    kalman.update(za, kalman_r);
+
+  #endif
+
+  adapt_measurement_noise(za);
+
+  // — Restricción del estado estimado —
+
+  if (kalman.x < MIN_DIST_Q8) kalman.x = MIN_DIST_Q8;
+
+  if (kalman.x > MAX_DIST_Q8) kalman.x = MAX_DIST_Q8;
+
+  return kalman.x;
+
+}
+
+  
+
+// Re-adquisición: P grande para que la siguiente lectura mande (10 cm²)
+
+void kalman_reacquire() { kalman.p.v = 100; }
+
+#endif
+
+  
+
+#if !defined(KALMAN_X10) && !defined(KALMAN_CV)
+
+// Filtro Kalman 1D en Q16.16; devuelve la posición en Q8.8
+
+uint16_t update_kalman(const uint16_t z[NUM_SENSORS]) {
+
+  #ifdef NOISE_ESTIMATION
+
+    Q16 p_prev = kalman.p;
+
+  #endif
+
+  kalman.predict();
+
+  // Sin lecturas P crece q por ciclo: se satura antes de desbordar
+
+  if (kalman.p.v > KALMAN_P_MAX * Q16_ONE) kalman.p.v = KALMAN_P_MAX * Q16_ONE;
+
+  int32_t zq[NUM_SENSORS];
+
+  Q16 r[NUM_SENSORS];
+
+  measurements_q16(z, zq, r);
+
+  bool reacquired = gate_innovations(zq, kalman.x, kalman.p, r);
+
+  if (reacquired) kalman_reacquire();
+
+  #ifdef NOISE_ESTIMATION
+
+    // El salto de x al re-adquirir no es movimiento del proceso: no da
+
+    // muestra de q (ni de R: P queda al tope)
+
+    int32_t x_prior = kalman.x;
+
+    estimate_measurement_noise(zq, kalman.x, kalman.p, r);
+
+  #endif
+
+  #ifdef KALMAN_FUSED
+
+    // — Fusión de todas las lecturas válidas en un solo paso (1/r en Q16.16) —
+
+    int32_t w[NUM_SENSORS];
+
+    for (uint8_t i = 0; i < NUM_SENSORS; i++)
+
+      w[i] = (int32_t)pgm_read_word(&INFO_Q12_TABLE[kalman_r[i].v]) * (10 * Q16_ONE / KALMAN_INFO_ONE);
+
+    kalman.update_fused(zq, w);
+
+  #else
+
+    // — Actualización secuencial con cada lectura válida —
+
+    kalman.update(zq, r);
+
+  #endif
+
+  #ifdef NOISE_ESTIMATION
+
+    if (!reacquired) estimate_process_noise(kalman.x - x_prior, p_prev);
+
+  #else
+
+    adapt_measurement_noise(z);
+
+  #endif
+
+  // — Restricción del estado estimado —
+
+  if (kalman.x < (int32_t)MIN_DIST_Q8 << 8) kalman.x = (int32_t)MIN_DIST_Q8 << 8;
+
+  if (kalman.x > (int32_t)MAX_DIST_Q8 << 8) kalman.x = (int32_t)MAX_DIST_Q8 << 8;
+
+  return kalman_position();
+
+}
+
+  
+
+// Re-adquisición: P al tope para que la siguiente lectura mande
+
+void kalman_reacquire() { kalman.p.v = KALMAN_P_MAX * Q16_ONE; }
+
+  
+
+// Posición filtrada en Q8.8 e incertidumbre x10 (saturada a uint8_t)
+
+uint16_t kalman_position() { return kalman.x >> 8; }
+
+  
+
+uint8_t kalman_p_x10() {
+
+  int32_t p_x10 = (kalman.p.v * 10) >> 16;
+
+  return (p_x10 > 255) ? 255 : p_x10;
+
+}
+
+#endif
+
+  
+
+// Mediciones Q8.8 y ruido x10 convertidos a Q16.16 (0 = sin eco se conserva)
+
+void measurements_q16(const uint16_t z[NUM_SENSORS], int32_t zq[NUM_SENSORS], Q16 r[NUM_SENSORS]) {
+
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+
+    zq[i] = (int32_t)z[i] << 8;
+
+    r[i].v = (int32_t)kalman_r[i].v * (Q16_ONE / 10);
+
+  }
+
+}
+
+  
+
+#if defined(NOISE_ESTIMATION) && !defined(KALMAN_X10) && !defined(KALMAN_CV)
+
+// Sage–Husa por sensor: R_i += ((e_i² - P) - R_i)·2^-s, con e_i = z_i - x
+
+// predicho. r[i] recibe R_i completo; kalman_r guarda su valor en décimas
+
+// para la tabla de información de KALMAN_FUSED.
+
+void estimate_measurement_noise(const int32_t zq[NUM_SENSORS], int32_t x, Q16 p, Q16 r[NUM_SENSORS]) {
+
+  const int32_t r_min = Q16_ONE / 10;                        // 0.1
+
+  const int32_t r_max = KALMAN_R_MAX_X10 * (Q16_ONE / 10);   // 2.0
+
+  // Con P por encima del mayor R (re-adquisición, objeto recién vuelto)
+
+  // e² - P es casi todo P: la muestra solo hundiría R hasta el suelo
+
+  if (p.v > r_max) return;
+
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+
+    if (zq[i] == 0) continue;
+
+    int32_t e = zq[i] - x;
+
+    int32_t sample = q16_mul(e, e) - p.v;
+
+    int32_t ri = noiseR[i].v + ((sample - noiseR[i].v) >> NOISE_FORGET_SHIFT);
+
+    if (ri < r_min) ri = r_min;
+
+    if (ri > r_max) ri = r_max;
+
+    noiseR[i].v = ri;
+
+    r[i].v = ri;
+
+    kalman_r[i].v = (ri * 10 + Q16_ONE / 2) >> 16;
+
+  }
+
+}
+
+  
+
+#ifndef KALMAN_CV
+
+// Sage–Husa del proceso (solo 1D): q += ((Δx² + P - P anterior) - q)·2^-s,
+
+// con Δx la corrección total del ciclo; sin lecturas no hay muestra
+
+void estimate_process_noise(int32_t dx, Q16 p_prev) {
+
+  if (dx == 0) return;
+
+  int32_t sample = q16_mul(dx, dx) + kalman.p.v - p_prev.v;
+
+  int32_t q = kalman.q.v + ((sample - kalman.q.v) >> NOISE_FORGET_SHIFT);
+
+  const int32_t q_min = kalman_q0_x100 * Q16_ONE / 100;
+
+  if (q < q_min) q = q_min;
+
+  if (q > NOISE_Q_MAX * Q16_ONE) q = NOISE_Q_MAX * Q16_ONE;
+
+  kalman.q.v = q;
+
+}
+
+#endif
+
+#endif
+
+  
+
+// Compuerta χ²: rechaza (z = 0) las lecturas con e² > NIS_GATE·(P + R),
+
+// sin divisiones. true si hay que re-adquirir: entonces acepta todas. Sin
+
+// armar (sin estimación todavía) la primera lectura re-adquiere.
+
+bool gate_innovations(int32_t zq[NUM_SENSORS], int32_t x, Q16 p, const Q16 r[NUM_SENSORS]) {
+
+  uint8_t valid = 0, rejected = 0;
+
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+
+    innovationRejected[i] = false;
+
+    #ifdef INNOVATION_GATING
+
+      if (zq[i] == 0) continue;
+
+      valid++;
+
+      if (!gateArmed) continue;
+
+      int32_t e = zq[i] - x;
+
+      if (q16_mul(e, e) > NIS_GATE * (p.v + r[i].v)) {
+
+        innovationRejected[i] = true;
+
+        rejected++;
+
+      }
+
+    #endif
+
+  }
+
+  if (!gateArmed) {
+
+    gateArmed = valid > 0;
+
+    return gateArmed;
+
+  }
+
+  if (valid > 0 && rejected == valid) {
+
+    if (++rejectStreak >= NIS_REACQUIRE) {
+
+      rejectStreak = 0;
+
+      for (uint8_t i = 0; i < NUM_SENSORS; i++) innovationRejected[i] = false;
+
+      return true;
+
+    }
+
+  } else {
+
+    rejectStreak = 0;
+
+  }
+
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+
+    if (innovationRejected[i]) zq[i] = 0;
+
+  }
+
+  return false;
+
+}
+
+  
+
+// Salud por sensor: aceptada -> OK; rechazo o eco perdido mientras otro
+
+// sensor sí ve el objeto -> fallo. Un FALLADO sale del ciclo y se reintenta.
+
+void update_sensor_health(const uint16_t z[NUM_SENSORS], unsigned long now) {
+
+  bool anyAccepted = false;
+
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+
+    if (z[i] > 0 && !innovationRejected[i]) anyAccepted = true;
+
+  }
+
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+
+    if (!sensors.fired(i)) {
+
+      // Reintento de un sensor fuera del ciclo
+
+      if (sensorHealth[i] == SENSOR_FAILED && now - sensorFailedMillis[i] >= HEALTH_RETRY_MS)
+
+        sensors.set_enabled(i, true);
+
+      continue;
+
+    }
+
+    uint8_t health = sensorHealth[i];
+
+    if (z[i] > 0 && !innovationRejected[i]) {
+
+      sensorFaults[i] = 0;
+
+      health = SENSOR_OK;
+
+      sensors.set_enabled(i, true);
+
+    } else if (innovationRejected[i] || anyAccepted) {
+
+      if (sensorFaults[i] < 255) sensorFaults[i]++;
+
+      if (health == SENSOR_FAILED || sensorFaults[i] >= HEALTH_FAILED) {
+
+        health = SENSOR_FAILED;
+
+        sensors.set_enabled(i, false);
+
+        sensorFailedMillis[i] = now;
+
+      } else if (sensorFaults[i] >= HEALTH_SUSPECT) {
+
+        health = SENSOR_SUSPECT;
+
+      }
+
+    }
+
+    #ifdef DEBUG
+
+      if (health != sensorHealth[i]) {
+
+        Serial.print(F("SENSOR ")); Serial.print(i + 1);
+
+        if (health == SENSOR_OK) Serial.println(F(": OK"));
+
+        else if (health == SENSOR_SUSPECT) Serial.println(F(": SOSPECHOSO"));
+
+        else Serial.println(F(": FALLADO"));
+
+      }
+
+    #endif
+
+    sensorHealth[i] = health;
+
+  }
+
+}
+
+  
+
+// — Ajuste dinámico de ruido de medición (simplificado y optimizado) —
+
+// Con dos o más lecturas válidas se compara la dispersión entre sensores
+
+void adapt_measurement_noise(const uint16_t z[NUM_SENSORS]) {
+
+  uint16_t z_min = 0xFFFF, z_max = 0;
+
+  uint8_t valid = 0;
+
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+
+    if (z[i] == 0 || innovationRejected[i]) continue;
+
+    valid++;
+
+    if (z[i] < z_min) z_min = z[i];
+
+    if (z[i] > z_max) z_max = z[i];
+
+  }
+
+  if (valid < 2) return;
+
+  bool disagree = (z_max - z_min) > SENSOR_AGREEMENT_Q8;
+
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+
+    if (z[i] == 0 || innovationRejected[i]) continue;
+
+    if (disagree) {
+
+      // Aumentar ruido (sensores discrepan)
+
+      if (kalman_r[i].v < KALMAN_R_MAX_X10) kalman_r[i].v++;  // Máximo 2.0
+
+    } else {
+
+      // Disminuir ruido (sensores concuerdan)
+
+      if (kalman_r[i].v > 1) kalman_r[i].v--;  // Mínimo 0.1
+
+    }
+
+  }
+
+}
+
+  
+
+#ifdef KALMAN_CV
+
+// Kalman de velocidad constante; devuelve la posición proyectada en Q8.8
+
+uint16_t update_kalman_cv(const uint16_t z[NUM_SENSORS]) {
+
+  kalman.predict();
+
+  // Sin lecturas la covarianza crece sin límite: al perder el objeto se
+
+  // reinicia la incertidumbre (y la velocidad) antes de desbordar Q16.16
+
+  if (kalman.p00.v > CV_LOST_P00 * Q16_ONE) {
+
+    kalman_reacquire();
+
+    gateArmed = false;
+
+  }
+
+  int32_t zq[NUM_SENSORS];
+
+  Q16 r[NUM_SENSORS];
+
+  measurements_q16(z, zq, r);
+
+  if (gate_innovations(zq, kalman.x, kalman.p00, r)) kalman_reacquire();
+
+  kalman.update(zq, r);
+
+  // — Restricciones físicas —
+
+  if (kalman.v > CV_MAX_SPEED * Q16_ONE) kalman.v = CV_MAX_SPEED * Q16_ONE;
+
+  if (kalman.v < -CV_MAX_SPEED * Q16_ONE) kalman.v = -CV_MAX_SPEED * Q16_ONE;
+
+  if (kalman.x < (int32_t)MIN_DIST_Q8 << 8) kalman.x = (int32_t)MIN_DIST_Q8 << 8;
+
+  if (kalman.x > (int32_t)MAX_DIST_Q8 << 8) kalman.x = (int32_t)MAX_DIST_Q8 << 8;
+
+  // — Posición proyectada CV_LEAD_MS hacia adelante —
+
+  int32_t lead = kalman.x + q16_mul(kalman.v, CV_LEAD_Q16);
+
+  if (lead < (int32_t)MIN_DIST_Q8 << 8) lead = (int32_t)MIN_DIST_Q8 << 8;
+
+  if (lead > (int32_t)MAX_DIST_Q8 << 8) lead = (int32_t)MAX_DIST_Q8 << 8;
+
+  return lead >> 8;
+
+}
+
+  
+
+// Objeto perdido o re-adquisición: incertidumbre inicial y velocidad nula
+
+void kalman_reacquire() {
+
+  kalman.v = 0;
+
+  kalman.p00.v = CV_LOST_P00 * Q16_ONE;
+
+  kalman.p01.v = 0;
+
+  kalman.p11.v = CV_P11_0;
+
+}
+
+  
+
+// Posición filtrada en Q8.8 e incertidumbre x10 (saturada a uint8_t)
+
+uint16_t kalman_position() { return kalman.x >> 8; }
+
+  
+
+uint8_t kalman_p_x10() {
+
+  int32_t p_x10 = (kalman.p00.v * 10) >> 16;
+
+  return (p_x10 > 255) ? 255 : p_x10;
+
+}
+
+  
+
+// Dispersión del historial explicada por la velocidad: |v|·dt·(HISTORY_SIZE - 1), en Q8.8
+
+uint16_t cv_motion_allowance() {
+
+  int32_t speed = (kalman.v < 0) ? -kalman.v : kalman.v;
+
+  return q16_mul(speed, CV_DT_Q16 * (HISTORY_SIZE - 1)) >> 8;
+
+}
+
+  
+
+// Tiempo hasta contacto x / -v en ms; -1 si el objeto no se acerca.
+
+// x / -v en segundos Q16.16, tope de 32767 s (más lento que 112 cm en 9 h)
+
+long cv_time_to_contact_ms() {
+
+  if (kalman.v >= 0) return -1;
+
+  if (-kalman.v <= (kalman.x >> 15)) return 32767000L;
+
+  return q16_mul(q16_div(kalman.x, -kalman.v), 1000);
+
+}
+
+#endif
+
+  
+
+// Cálculo de variación en historial optimizado para enteros (Q8.8)
+
+uint16_t calculate_history_variation() {
+
+  uint16_t max_val = 0, min_val = 0xFFFF;
+
+  for (uint8_t i = 0; i < HISTORY_SIZE; i++) {
+
+    uint16_t val = estimationHistory[i];
+
+    if (val == 0) continue;  // Ignorar valores no inicializados
+
+    if (val > max_val) max_val = val;
+
+    if (val < min_val) min_val = val;
+
+  }
+
+  return (min_val == 0xFFFF) ? 0 : (max_val - min_val);
+
+}
+
+  
+
+// Conversión a centímetros en Q8.8: multiplicación y desplazamiento
+
+unsigned long echo_to_q8(unsigned long duration) {
+
+  return (duration * echoFactor) >> ECHO_FACTOR_SHIFT;
+
+}
+
+  
+
+// Selección del factor de conversión según la temperatura ambiente
+
+void set_sound_temperature(int8_t celsius) {
+
+  int8_t index = (celsius - SOUND_TEMP_MIN + SOUND_TEMP_STEP / 2) / SOUND_TEMP_STEP;
+
+  if (celsius < SOUND_TEMP_MIN) index = 0;
+
+  if (index >= SOUND_TEMP_COUNT) index = SOUND_TEMP_COUNT - 1;
+
+  echoFactor = pgm_read_word(&ECHO_FACTOR_TABLE[index]);
+
+}
+
+  
+
+// Impresión de un valor Q8.8 como centímetros con dos decimales
+
+void print_q8(uint16_t value) {
+
+  uint8_t hundredths = ((value & 0xFF) * 100U) >> 8;
+
+  Serial.print(value >> 8);
+
+  Serial.print('.');
+
+  if (hundredths < 10) Serial.print('0');
 
-  return (min_val == 255) ? 0 : (max_val - min_val);
+  Serial.print(hundredths);
 
 }
\ No newline at end of file
@@ -0,0 +1,376 @@
+// ============================================================
+//  FILTRO KALMAN GENÉRICO PARA LOS SKETCHES filtrokalman*.cpp
+//  KalmanFilter<T, StateDim, MeasDim>: T es el tipo numérico de la
+//  covarianza (float, Tenths, Q16), StateDim el tamaño del estado
+//  (1: posición, 2: posición + velocidad) y MeasDim el número de
+//  mediciones escalares aplicadas en cada actualización (sensores).
+//  Solo cabecera: cada sketch instancia el filtro que necesita.
+// ============================================================
+
+#ifndef KALMAN_H
+#define KALMAN_H
+
+#include <stdint.h>
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#endif
+#ifndef PROGMEM
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_float(addr) (*(const float *)(addr))
+#endif
+
+// — Punto fijo Q16.16 (cm, cm², ...) sobre int32_t —
+// Rango ±32768 con resolución 1/65536 (1.5e-5): cubre distancias de
+// 0-400 cm, P hasta cientos de cm² y q = 0.01 sin cuantizar a cero.
+// q16_mul redondea al más cercano; q16_div trunca hacia cero. Solo el
+// resultado debe caber en rango: en el PC usan un intermedio de 64 bits;
+// en el AVR, donde las operaciones de 64 bits son llamadas a libgcc mucho
+// más lentas, q16_mul32/q16_div32, que dan el mismo resultado bit a bit
+// solo con operaciones de 32 bits (prueba_kalman.cpp lo comprueba).
+#define Q16_ONE 65536L
+
+struct Q16 {
+  int32_t v;
+};
+
+// (a·b + 0.5) >> 16 por productos parciales de 16 bits: a = ah·2^16 + al
+// con ah con signo y al sin signo. Los términos altos se suman módulo 2^32
+// (uint32_t), que es exacto siempre que el resultado quepa en int32_t.
+inline int32_t q16_mul32(int32_t a, int32_t b) {
+  int16_t ah = (int16_t)(a >> 16), bh = (int16_t)(b >> 16);
+  uint16_t al = (uint16_t)a, bl = (uint16_t)b;
+  uint32_t low = ((uint32_t)al * bl + (Q16_ONE / 2)) >> 16;
+  uint32_t mid = (uint32_t)((int32_t)ah * bl) + (uint32_t)((int32_t)al * bh);
+  return (int32_t)(((uint32_t)((int32_t)ah * bh) << 16) + mid + low);
+}
+
+// (a << 16) / b truncado hacia cero: parte entera de |a| / |b| (ninguna
+// en las ganancias, |a| < |b|) y 16 bits más del cociente por resta y
+// desplazamiento (resto < |b| <= 2^31)
+inline int32_t q16_div32(int32_t a, int32_t b) {
+  bool negative = (a < 0) != (b < 0);
+  uint32_t ua = (a < 0) ? 0u - (uint32_t)a : (uint32_t)a;
+  uint32_t ub = (b < 0) ? 0u - (uint32_t)b : (uint32_t)b;
+  uint32_t q = 0, rem = ua;
+  if (ua >= ub) {
+    q = ua / ub;
+    rem = ua % ub;
+  }
+  for (uint8_t i = 0; i < 16; i++) {
+    rem <<= 1;
+    uint32_t bit = (rem >= ub);
+    rem -= ub & (0u - bit);
+    q = (q << 1) | bit;
+  }
+  return negative ? (int32_t)(0u - q) : (int32_t)q;
+}
+
+#ifdef __AVR__
+inline int32_t q16_mul(int32_t a, int32_t b) { return q16_mul32(a, b); }
+inline int32_t q16_div(int32_t a, int32_t b) { return q16_div32(a, b); }
+#else
+inline int32_t q16_mul(int32_t a, int32_t b) {
+  return (int32_t)(((int64_t)a * b + (Q16_ONE / 2)) >> 16);
+}
+
+inline int32_t q16_div(int32_t a, int32_t b) {
+  return (int32_t)(((int64_t)a << 16) / b);
+}
+#endif
+
+// — Décimas sobre uint8_t (valor x10), el escalado de filtrokalman4/5.cpp —
+// Con GainTable = true la ganancia sale de una tabla en flash (TenthsTable)
+template <bool GainTable>
+struct TenthsT {
+  uint8_t v;
+};
+
+typedef TenthsT<false> Tenths;
+typedef TenthsT<true> TenthsTable;
+
+// Ganancia K x10 y covarianza posterior P' x10 de una actualización
+struct TenthsGain {
+  uint8_t k;
+  uint8_t p;
+};
+
+// K = 10·P / (P + R), P' = P·(10 - K) / 10: la aritmética entera original
+constexpr uint8_t tenths_gain_k(uint8_t p, uint8_t r) {
+  return (p + r > 0) ? (10 * p) / (p + r) : 0;
+}
+
+inline TenthsGain tenths_gain(uint8_t p, uint8_t r) {
+  uint8_t k = tenths_gain_k(p, r);
+  TenthsGain g = {k, (uint8_t)((p * (10 - k)) / 10)};
+  return g;
+}
+
+// — Tabla de ganancias precalculada: los pares (P, R) del régimen normal —
+// P x10 en 0..KALMAN_GAIN_P_MAX y R x10 en 0..KALMAN_GAIN_R_MAX (el
+// rango de ruido adaptativo); cada byte es K << 4 | P' (ambos <= 15).
+// P sí pasa de 1.5 cm²: la re-adquisición la pone a 10 y sin eco satura en
+// 25.5. Ahí se recurre a la aritmética (mismo resultado, una división):
+// cubrir P hasta 255 pediría P' de 5 bits y 256 · 21 entradas de 2 bytes
+// (10.5 KB de flash). Dos actualizaciones con R <= 2.0 bastan para volver
+// a la tabla desde cualquier P (prueba_kalman.cpp lo recorre entero), así
+// que cada re-adquisición o vuelta del objeto cuesta como mucho dos.
+#define KALMAN_GAIN_P_MAX 15
+#define KALMAN_GAIN_R_MAX 20
+
+constexpr uint8_t tenths_gain_pack(uint8_t p, uint8_t k) {
+  return (k << 4) | ((p * (10 - k)) / 10);
+}
+
+constexpr uint8_t tenths_gain_entry(uint16_t i) {
+  return tenths_gain_pack(i / (KALMAN_GAIN_R_MAX + 1),
+                          tenths_gain_k(i / (KALMAN_GAIN_R_MAX + 1), i % (KALMAN_GAIN_R_MAX + 1)));
+}
+
+// Lista de índices 0..N-1 en compilación (C++11 no tiene index_sequence)
+template <uint16_t... I>
+struct KalmanIndexList {};
+
+template <uint16_t N, uint16_t... I>
+struct KalmanMakeIndex : KalmanMakeIndex<N - 1, N - 1, I...> {};
+
+template <uint16_t... I>
+struct KalmanMakeIndex<0, I...> {
+  typedef KalmanIndexList<I...> type;
+};
+
+template <typename L>
+struct TenthsGainTable;
+
+template <uint16_t... I>
+struct TenthsGainTable<KalmanIndexList<I...> > {
+  static const uint8_t data[sizeof...(I)];
+};
+
+// Solo ocupa flash si algún filtro usa TenthsTable
+template <uint16_t... I>
+const uint8_t TenthsGainTable<KalmanIndexList<I...> >::data[sizeof...(I)] PROGMEM = {
+  tenths_gain_entry(I)...
+};
+
+typedef TenthsGainTable<KalmanMakeIndex<(KALMAN_GAIN_P_MAX + 1) * (KALMAN_GAIN_R_MAX + 1)>::type>
+  TenthsGainLut;
+
+template <bool GainTable>
+struct TenthsGainPolicy {
+  static TenthsGain gain(uint8_t p, uint8_t r) { return tenths_gain(p, r); }
+};
+
+template <>
+struct TenthsGainPolicy<true> {
+  static TenthsGain gain(uint8_t p, uint8_t r) {
+    if (p > KALMAN_GAIN_P_MAX || r > KALMAN_GAIN_R_MAX) return tenths_gain(p, r);
+    uint8_t entry = pgm_read_byte(&TenthsGainLut::data[p * (KALMAN_GAIN_R_MAX + 1) + r]);
+    TenthsGain g = {(uint8_t)(entry >> 4), (uint8_t)(entry & 0x0F)};
+    return g;
+  }
+};
+
+// — Operaciones del filtro para cada tipo numérico —
+// state_type es el tipo de x y de las mediciones z; una medición no
+// válida (sin eco) es z <= 0 en todos los sketches.
+// info_type es la información (1/r) de cada medición para la fusión en
+// forma de información (update_fused): fuse() es la única división y
+// devuelve P posterior en fused_type, con más resolución que T si hace falta.
+// gain_type es lo que gain() entrega a scale() y shrink().
+template <typename T>
+struct KalmanScalar;
+
+template <>
+struct KalmanScalar<float> {
+  typedef float state_type;
+  typedef float delta_type;
+  static bool valid(float z) { return z > 0; }
+  static float innovation(float z, float x) { return z - x; }
+  static float add(float a, float b) { return a + b; }
+  static float sub(float a, float b) { return a - b; }
+  static float mul(float a, float b) { return a * b; }
+  static float div(float a, float b) { return a / b; }
+  typedef float gain_type;
+  static float gain(float p, float r) { return p / (p + r); }
+  static float scale(float k, float e) { return k * e; }
+  static float shrink(float p, float k) { return (1 - k) * p; }
+  typedef float info_type;
+  typedef float fused_type;
+  static float fuse(float p, float s) { return p / (1 + p * s); }
+  static float fused_cov(float p) { return p; }
+  static float info_scale(float p, float w, float e) { return p * w * e; }
+};
+
+// Estado en cm sobre uint16_t (Q8.8 en filtrokalman5, entero en filtrokalman4),
+// covarianzas en décimas: exactamente la aritmética entera de esos sketches.
+// Información 1/r en Q12 respecto de r x10 (KALMAN_INFO_ONE / r_x10):
+// p·w = p_x10·w / KALMAN_INFO_ONE sin escalados por 10 intermedios.
+#define KALMAN_INFO_ONE 4096L
+template <bool GainTable>
+struct KalmanScalar<TenthsT<GainTable> > {
+  typedef TenthsT<GainTable> V;
+  typedef uint16_t state_type;
+  typedef int32_t delta_type;
+  static bool valid(uint16_t z) { return z > 0; }
+  static int32_t innovation(uint16_t z, uint16_t x) { return (int32_t)z - (int32_t)x; }
+  // P satura en 25.5 en lugar de volver a 0 tras muchos ciclos sin eco
+  static V add(V a, V b) {
+    uint16_t sum = a.v + b.v;
+    V t = {(uint8_t)(sum > 255 ? 255 : sum)};
+    return t;
+  }
+  typedef TenthsGain gain_type;
+  static TenthsGain gain(V p, V r) { return TenthsGainPolicy<GainTable>::gain(p.v, r.v); }
+  static int32_t scale(TenthsGain g, int32_t e) { return (g.k * e) / 10; }
+  static V shrink(V, TenthsGain g) { V t = {g.p}; return t; }
+  typedef uint16_t info_type;
+  typedef uint32_t fused_type;  // p' x10 en Q8: las décimas enteras anulan la ganancia
+  // p' = p / (1 + p·Σw), con Σw en Q12 (uint32_t: 255 · N · 4096)
+  static uint32_t fuse(V p, uint16_t s) {
+    uint32_t d = KALMAN_INFO_ONE + (uint32_t)p.v * s;
+    return ((uint32_t)p.v * KALMAN_INFO_ONE << 8) / d;
+  }
+  static V fused_cov(uint32_t p) { V t = {(uint8_t)(p >> 8)}; return t; }
+  // k_i = p'·w_i < 1, en Q12: k · innovación Q8.8 cabe en int32_t
+  static int32_t info_scale(uint32_t p, uint16_t w, int32_t e) {
+    int32_t k = (p * w) >> 8;
+    return (k * e) / KALMAN_INFO_ONE;
+  }
+};
+
+// Estado en cm Q16.16 (int32_t), covarianzas Q16.16
+template <>
+struct KalmanScalar<Q16> {
+  typedef int32_t state_type;
+  typedef int32_t delta_type;
+  static bool valid(int32_t z) { return z > 0; }
+  static int32_t innovation(int32_t z, int32_t x) { return z - x; }
+  static Q16 add(Q16 a, Q16 b) { Q16 t = {a.v + b.v}; return t; }
+  static Q16 sub(Q16 a, Q16 b) { Q16 t = {a.v - b.v}; return t; }
+  static Q16 mul(Q16 a, Q16 b) { Q16 t = {q16_mul(a.v, b.v)}; return t; }
+  static Q16 div(Q16 a, Q16 b) { Q16 t = {q16_div(a.v, b.v)}; return t; }
+  typedef Q16 gain_type;
+  static Q16 gain(Q16 p, Q16 r) { return div(p, add(p, r)); }
+  static int32_t scale(Q16 k, int32_t e) { return q16_mul(k.v, e); }
+  static Q16 shrink(Q16 p, Q16 k) { return sub(p, mul(k, p)); }
+  typedef int32_t info_type;  // 1/r en Q16.16
+  typedef Q16 fused_type;
+  static Q16 fuse(Q16 p, int32_t s) { Q16 d = {(int32_t)(Q16_ONE + q16_mul(p.v, s))}; return div(p, d); }
+  static Q16 fused_cov(Q16 p) { return p; }
+  static int32_t info_scale(Q16 p, int32_t w, int32_t e) { return q16_mul(q16_mul(p.v, w), e); }
+};
+
+// — Desenrollado en compilación del bucle sobre las MeasDim mediciones —
+template <uint8_t I, uint8_t N>
+struct KalmanUnroll {
+  template <typename F>
+  static void run(F &f) {
+    f(I);
+    KalmanUnroll<I + 1, N>::run(f);
+  }
+};
+
+template <uint8_t N>
+struct KalmanUnroll<N, N> {
+  template <typename F>
+  static void run(F &) {}
+};
+
+template <typename T, uint8_t StateDim, uint8_t MeasDim>
+class KalmanFilter;
+
+// — Filtro 1D: objeto estacionario (x = x, P += q) —
+template <typename T, uint8_t MeasDim>
+class KalmanFilter<T, 1, MeasDim> {
+  typedef KalmanScalar<T> S;
+public:
+  typedef typename S::state_type X;
+
+  X x;  // estimación
+  T p;  // incertidumbre
+  T q;  // ruido de proceso
+
+  KalmanFilter(X x0, T p0, T q0) : x(x0), p(p0), q(q0) {}
+
+  void predict() { p = S::add(p, q); }
+
+  // Actualización secuencial con cada medición válida; r[i] es su ruido
+  void update(const X z[MeasDim], const T r[MeasDim]) {
+    auto step = [&](uint8_t i) { update_one(z[i], r[i]); };
+    KalmanUnroll<0, MeasDim>::run(step);
+  }
+
+  void update_one(X z, T r) {
+    if (!S::valid(z)) return;
+    typename S::gain_type k = S::gain(p, r);
+    x += S::scale(k, S::innovation(z, x));
+    p = S::shrink(p, k);
+  }
+
+  // Fusión en forma de información: todas las mediciones válidas en un
+  // paso, P⁻¹ += Σ w_i y x += P·Σ w_i·(z_i - x), con w[i] = 1/r_i. Una
+  // sola división por ciclo sea cual sea el número de sensores.
+  void update_fused(const X z[MeasDim], const typename S::info_type w[MeasDim]) {
+    typename S::info_type s = 0;
+    auto sum = [&](uint8_t i) { if (S::valid(z[i])) s += w[i]; };
+    KalmanUnroll<0, MeasDim>::run(sum);
+    if (s == 0) return;
+    typename S::fused_type p_post = S::fuse(p, s);
+    typename S::delta_type dx = 0;
+    auto correct = [&](uint8_t i) {
+      if (S::valid(z[i])) dx += S::info_scale(p_post, w[i], S::innovation(z[i], x));
+    };
+    KalmanUnroll<0, MeasDim>::run(correct);
+    x += dx;
+    p = S::fused_cov(p_post);
+  }
+};
+
+// — Filtro 2D: velocidad constante con aceleración blanca, H = [1 0] —
+template <typename T, uint8_t MeasDim>
+class KalmanFilter<T, 2, MeasDim> {
+  typedef KalmanScalar<T> S;
+public:
+  typedef typename S::state_type X;
+
+  X x;           // posición
+  X v;           // velocidad
+  T p00, p01, p11;
+  T dt;          // periodo de predicción
+  T q00, q01, q11;
+
+  KalmanFilter(X x0, T p00_0, T p11_0, T dt0, T q00_0, T q01_0, T q11_0)
+    : x(x0), v(0), p00(p00_0), p01(), p11(p11_0), dt(dt0), q00(q00_0), q01(q01_0), q11(q11_0) {}
+
+  // x += v·dt, P = F·P·Fᵀ + Q
+  void predict() {
+    x += S::scale(dt, v);
+    T dt_p11 = S::mul(dt, p11);
+    p00 = S::add(p00, S::add(S::mul(dt, S::add(S::add(p01, p01), dt_p11)), q00));
+    p01 = S::add(p01, S::add(dt_p11, q01));
+    p11 = S::add(p11, q11);
+  }
+
+  void update(const X z[MeasDim], const T r[MeasDim]) {
+    auto step = [&](uint8_t i) { update_one(z[i], r[i]); };
+    KalmanUnroll<0, MeasDim>::run(step);
+  }
+
+  void update_one(X z, T r) {
+    if (!S::valid(z)) return;
+    T s = S::add(p00, r);
+    T k0 = S::div(p00, s);
+    T k1 = S::div(p01, s);
+    typename S::delta_type innovation = S::innovation(z, x);
+    x += S::scale(k0, innovation);
+    v += S::scale(k1, innovation);
+    T p01_prev = p01;
+    p11 = S::sub(p11, S::mul(k1, p01_prev));
+    p01 = S::sub(p01, S::mul(k0, p01_prev));
+    p00 = S::sub(p00, S::mul(k0, p00));
+  }
+};
+
+#endif
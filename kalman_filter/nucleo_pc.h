@@ -0,0 +1,261 @@
+// ============================================================
+//  NÚCLEO ARDUINO SIMULADO PARA LAS PRUEBAS DE PC (prueba_*.cpp)
+//  Lo justo para compilar filtrokalman5.cpp en el PC:
+//  - Con KALMAN_REPLAY: pines y F() sin efecto, como en afinador.cpp.
+//  - Sin KALMAN_REPLAY: además un reloj micros()/millis() simulado (con la
+//    resolución de 4 µs del UNO), un registro de entrada por pin, las
+//    interrupciones pin-change y un HC-SR04 por sensor que sube y baja su
+//    ECHO en el instante exacto de cada flanco. La captura por ISR del
+//    sketch corre tal cual, sin sustitutos.
+//  Serial guarda cada línea impresa con su instante: las pruebas leen las
+//  líneas de ciclo del DEBUG con debug_parse_cycle() de registro_debug.h.
+//  Cada escenario corre en un proceso hijo (pc_scenario) y parte del
+//  estado inicial del sketch, como las repeticiones de afinador.cpp.
+// ============================================================
+
+#ifndef NUCLEO_PC_H
+#define NUCLEO_PC_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define A0 14
+#define F(s) (s)
+
+#define PC_PINS 20
+
+unsigned long pcMicros = 0;  // reloj simulado (µs)
+
+// — Serial: líneas impresas con el instante en que terminaron —
+struct PcLine {
+  unsigned long us;
+  std::string text;
+};
+
+struct PcSerial {
+  std::vector<PcLine> lines;
+  std::string pending;
+
+  void begin(long) {}
+  void print(const char *s) { pending += s; }
+  void print(char c) { pending += c; }
+  void print(unsigned char v) { print((unsigned long)v); }
+  void print(int v) { print((long)v); }
+  void print(unsigned int v) { print((unsigned long)v); }
+  void print(long v) { char b[24]; snprintf(b, sizeof(b), "%ld", v); pending += b; }
+  void print(unsigned long v) { char b[24]; snprintf(b, sizeof(b), "%lu", v); pending += b; }
+  void print(double v) { char b[32]; snprintf(b, sizeof(b), "%.2f", v); pending += b; }  // 2 decimales, como Arduino
+  template <typename T> void println(T v) { print(v); println(); }
+  void println() {
+    PcLine l = {pcMicros, pending};
+    lines.push_back(l);
+    pending.clear();
+  }
+} Serial;
+
+#ifdef KALMAN_REPLAY
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+#else
+
+// — Registros y pin-change —
+#define bit(b) (1UL << (b))
+#define ISR(vect) void vect()
+void PCINT0_vect();  // los tres vectores del sketch hacen lo mismo
+
+volatile uint8_t pcPinReg[PC_PINS];  // PINx simulado: un registro por pin
+volatile uint8_t PCICR;
+volatile uint8_t pcPcmsk;
+bool pcInterruptsOn = true;
+bool pcInterruptPending = false;
+
+inline uint8_t digitalPinToPort(uint8_t pin) { return pin; }
+inline uint8_t digitalPinToBitMask(uint8_t) { return 1; }
+inline volatile uint8_t *portInputRegister(uint8_t port) { return &pcPinReg[port]; }
+inline volatile uint8_t *digitalPinToPCMSK(uint8_t) { return &pcPcmsk; }
+inline uint8_t digitalPinToPCMSKbit(uint8_t pin) { return pin % 8; }
+inline uint8_t digitalPinToPCICRbit(uint8_t pin) { return pin / 8; }
+
+inline void noInterrupts() { pcInterruptsOn = false; }
+inline void interrupts() {
+  pcInterruptsOn = true;
+  if (pcInterruptPending) {
+    pcInterruptPending = false;
+    PCINT0_vect();
+  }
+}
+
+inline unsigned long micros() { return pcMicros & ~3UL; }
+inline unsigned long millis() { return pcMicros / 1000; }
+inline void pinMode(uint8_t, uint8_t) {}
+
+// — HC-SR04 simulado —
+// Tras un pulso de TRIG de 10 µs sube ECHO al cabo de riseUs y lo baja
+// pasado el viaje de ida y vuelta a distanceCm (o noEchoUs si no hay
+// objeto: el módulo real mantiene ECHO alto ~38 ms). Ignora disparos
+// mientras está ocupado; con dead el ECHO no sube nunca. hearsSensor >= 0:
+// oye el pulso de ese sensor y baja ECHO cuando vuelve el eco ajeno (cruce).
+#define PC_SOUND_CM_US 0.034342f  // c a 20 °C: 331.3 + 0.606·20 m/s
+
+struct PcSonar {
+  uint8_t trig = 0, echo = 0;
+  float distanceCm = 0;          // <= 0: sin objeto
+  unsigned long riseUs = 450;    // disparo -> subida de ECHO
+  unsigned long noEchoUs = 38000;
+  int8_t hearsSensor = -1;
+  bool dead = false;             // pin ECHO muerto: nunca sube
+  // estado
+  bool trigHigh = false;
+  unsigned long trigRise = 0;
+  unsigned long riseAt = 0, fallAt = 0;  // 0: sin flanco pendiente
+  unsigned long pulses = 0;              // pulsos de TRIG recibidos
+  unsigned long lastPulse = 0;
+  unsigned long triggers = 0;            // disparos aceptados
+  unsigned long lastTrigger = 0;
+};
+
+PcSonar pcSonar[8];
+uint8_t pcSonars = 0;
+unsigned long pcIsrLatencyUs = 3;
+
+inline unsigned long pc_round_trip_us(float cm) { return (unsigned long)(2 * cm / PC_SOUND_CM_US + 0.5f); }
+
+inline void pc_attach(uint8_t trig, uint8_t echo) {
+  PcSonar &s = pcSonar[pcSonars++];
+  s.trig = trig;
+  s.echo = echo;
+}
+
+inline void pc_set_echo(PcSonar &s, bool level) {
+  pcPinReg[s.echo] = level ? 1 : 0;
+  if (pcInterruptsOn) PCINT0_vect();
+  else pcInterruptPending = true;
+}
+
+// Aplica en orden los flancos pendientes hasta t
+inline void pc_advance_to(unsigned long t) {
+  for (;;) {
+    unsigned long next = t + 1;
+    PcSonar *who = 0;
+    for (uint8_t i = 0; i < pcSonars; i++) {
+      PcSonar &s = pcSonar[i];
+      if (s.riseAt && s.riseAt < next) { next = s.riseAt; who = &s; }
+      if (s.fallAt && s.fallAt < next && !s.riseAt) { next = s.fallAt; who = &s; }
+    }
+    if (!who) break;
+    pcMicros = next + pcIsrLatencyUs;
+    if (who->riseAt) {
+      who->riseAt = 0;
+      pc_set_echo(*who, true);
+    } else {
+      who->fallAt = 0;
+      pc_set_echo(*who, false);
+    }
+  }
+  if (t > pcMicros) pcMicros = t;
+}
+
+inline void delayMicroseconds(unsigned int us) { pc_advance_to(pcMicros + us); }
+
+inline void digitalWrite(uint8_t pin, uint8_t level) {
+  for (uint8_t i = 0; i < pcSonars; i++) {
+    PcSonar &s = pcSonar[i];
+    if (s.trig != pin) continue;
+    if (level == HIGH && !s.trigHigh) {
+      s.trigHigh = true;
+      s.trigRise = pcMicros;
+    } else if (level == LOW && s.trigHigh) {
+      s.trigHigh = false;
+      if (pcMicros - s.trigRise >= 10) {
+        s.pulses++;
+        s.lastPulse = pcMicros;
+      }
+      bool busy = pcPinReg[s.echo] || s.riseAt || s.fallAt;
+      if (pcMicros - s.trigRise < 10 || busy) continue;
+      s.triggers++;
+      s.lastTrigger = pcMicros;
+      if (s.dead) continue;
+      s.riseAt = pcMicros + s.riseUs;
+      if (s.distanceCm > 0) s.fallAt = s.riseAt + pc_round_trip_us(s.distanceCm);
+      else s.fallAt = s.riseAt + s.noEchoUs;
+    }
+  }
+}
+
+// Cruces: ECHO de quien oye a otro sensor baja con el eco ajeno si este
+// llega antes que el propio (llamar tras cada ciclo de disparos)
+inline void pc_apply_crosstalk() {
+  for (uint8_t i = 0; i < pcSonars; i++) {
+    PcSonar &s = pcSonar[i];
+    if (s.hearsSensor < 0 || !s.fallAt) continue;
+    PcSonar &o = pcSonar[s.hearsSensor];
+    if (!o.fallAt) continue;
+    unsigned long rise = s.riseAt ? s.riseAt : s.lastTrigger + s.riseUs;
+    if (o.fallAt > rise && o.fallAt < s.fallAt) s.fallAt = o.fallAt;
+  }
+}
+
+void setup();
+void loop();
+
+// Corre loop() durante us de tiempo simulado; cada llamada cuesta
+// loopCostUs además de sus propias esperas. Devuelve el mayor tiempo que
+// una sola llamada retuvo loop() (µs).
+inline unsigned long pc_run(unsigned long us, unsigned long loopCostUs = 20) {
+  unsigned long end = pcMicros + us, longest = 0;
+  while (pcMicros < end) {
+    unsigned long t0 = pcMicros;
+    loop();
+    pc_apply_crosstalk();
+    if (pcMicros - t0 > longest) longest = pcMicros - t0;
+    pc_advance_to(pcMicros + loopCostUs);
+  }
+  return longest;
+}
+
+#endif  // KALMAN_REPLAY
+
+// — Escenarios aislados —
+// Corre f en un proceso hijo (estado del sketch intacto) y devuelve si
+// pasó: f devuelve el número de comprobaciones fallidas.
+int pcFailures = 0;
+
+template <typename F>
+inline bool pc_scenario(const char *name, F f) {
+  printf("%s\n", name);
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    int failed = f();
+    fflush(stdout);
+    _exit(failed ? 1 : 0);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  if (!ok) pcFailures++;
+  return ok;
+}
+
+// Comprobación con mensaje; cuenta en el valor que devuelve el escenario
+#define PC_CHECK(cond, ...)                                   \
+  do {                                                        \
+    if (!(cond)) {                                            \
+      printf("  FALLO: ");                                    \
+      printf(__VA_ARGS__);                                    \
+      printf("\n");                                           \
+      failed++;                                               \
+    }                                                         \
+  } while (0)
+
+#endif
@@ -0,0 +1,193 @@
+// ============================================================
+//  PRUEBA DE APROXIMACIÓN: FILTRO 1-D FRENTE A VELOCIDAD CONSTANTE
+//  Herramienta de PC (no es un sketch): filtrokalman5.cpp se compila dos
+//  veces con KALMAN_REPLAY, tal cual y con KALMAN_CV, y los dos reciben
+//  las mismas lecturas simuladas de un objeto que se acerca a velocidad
+//  constante desde fuera de alcance hasta 80 cm y se queda ahí 2 s (ruido
+//  0.3 cm, 1 % sin eco; las lecturas pasan por los mismos recortes que
+//  read_distance). Por velocidad, sobre 20 episodios:
+//  - latencia de activación desde que el objeto cruza SAFE_MAX_DIST
+//    (negativa: la activación se adelanta, que es lo que busca KALMAN_CV)
+//  - episodios sin activar y activaciones tempranas (el objeto aún más
+//    allá de SAFE_MAX_DIST de lo que explica CV_LEAD_MS)
+//  - con KALMAN_CV, error del tiempo al contacto al activar
+//  Sale con 1 si falla alguna comprobación.
+//
+//  Compilar: g++ -std=gnu++11 -O2 -o prueba_aproximacion prueba_aproximacion.cpp
+//  Uso:      ./prueba_aproximacion
+// ============================================================
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#define KALMAN_REPLAY
+#include "nucleo_pc.h"
+#include "kalman.h"
+
+// Las dos variantes del sketch conviven en espacios de nombres distintos;
+// las macros de la primera inclusión son las mismas en la segunda
+namespace uno {
+#include "filtrokalman5.cpp"
+}
+#define KALMAN_CV
+namespace cv {
+#include "filtrokalman5.cpp"
+}
+
+#define EPISODES 20
+#define START_CM 130.0f
+#define STOP_CM 80.0f
+#define HOLD_MS 2000
+#define AWAY_MS 8000  // > LED_ON_DURATION + LED_OFF_DURATION: LED listo
+#define EARLY_MARGIN_CM 2.0f
+
+// Lectura simulada de un sensor como la entregaría read_distance()
+static uint16_t reading_q8(float cm) {
+  using namespace uno;
+  if (cm <= 0 || cm > MAX_DIST + RANGE_GATE_MARGIN) return 0;  // fuera de la ventana
+  if (cm > DIFFUSE_ZONE_START && cm < DIFFUSE_ZONE_END) return OUT_OF_RANGE_Q8;
+  uint16_t d = (uint16_t)(cm * 256 + 0.5f);
+  if (d < MIN_DIST_Q8) return MIN_DIST_Q8;
+  if (d > MAX_DIST_Q8) return MAX_DIST_Q8;
+  return d;
+}
+
+// Ciclos de un episodio: distancia real y lecturas por sensor
+struct Cycle {
+  float truth;
+  float z[2];
+};
+
+static std::vector<Cycle> make_episodes(float speed, unsigned seed) {
+  std::vector<Cycle> t;
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> noise(0, 0.3f);
+  std::uniform_real_distribution<float> u(0, 1);
+  const float step = speed * uno::READ_INTERVAL / 1000;
+  for (int e = 0; e < EPISODES; e++) {
+    std::vector<float> path(AWAY_MS / uno::READ_INTERVAL, 0.0f);  // sin objeto
+    for (float x = START_CM; x > STOP_CM; x -= step) path.push_back(x);
+    path.resize(path.size() + HOLD_MS / uno::READ_INTERVAL, STOP_CM);
+    for (float x : path) {
+      Cycle c;
+      c.truth = x;
+      for (int i = 0; i < 2; i++) c.z[i] = (x <= 0 || u(rng) < 0.01f) ? 0 : x + noise(rng);
+      t.push_back(c);
+    }
+  }
+  return t;
+}
+
+struct Outcome {
+  std::vector<long> latencyMs;  // una por episodio activado
+  std::vector<float> ttcError;  // |T estimado - T real| / T real al activar
+  int misses, early;
+};
+
+// Una variante del sketch, vista desde la prueba
+struct Variant {
+  const char *name;
+  void (*init)();
+  void (*led)(unsigned long now);
+  void (*cycle)(const uint16_t *z, unsigned long now);
+  bool (*fired)(uint8_t i);
+  uint8_t *ledState;
+  long (*ttc)();          // ms al contacto; < 0 si la variante no lo estima
+  unsigned long leadMs;   // anticipación de la activación
+};
+
+#define SENSORS 2
+static_assert(sizeof(uno::SENSOR_PINS) / sizeof(uno::SENSOR_PINS[0]) == SENSORS, "la prueba simula 2 sensores");
+
+static const Variant STILL = {
+  "1-D (estacionario)", uno::kalman_init, uno::update_led_cycle, uno::process_cycle,
+  [](uint8_t i) { return uno::sensors.fired(i); }, &uno::currentLedState,
+  []() { return -1L; }, 0
+};
+static const Variant MOVING = {
+  "KALMAN_CV", cv::kalman_init, cv::update_led_cycle, cv::process_cycle,
+  [](uint8_t i) { return cv::sensors.fired(i); }, &cv::currentLedState,
+  []() { return cv::cv_time_to_contact_ms(); }, CV_LEAD_MS
+};
+
+// Repite los episodios con una variante (en el proceso del escenario)
+static Outcome replay(const Variant &k, const std::vector<Cycle> &t, float speed) {
+  using uno::SAFE_MAX_DIST;
+  Outcome out = {};
+  k.init();
+  bool episode = false;
+  unsigned long entry = 0;
+  for (size_t c = 0; c < t.size(); c++) {
+    unsigned long now = c * uno::READ_INTERVAL;
+    k.led(now);  // entre ciclos el LED avanza con loop()
+    uint16_t z[SENSORS];
+    for (uint8_t i = 0; i < SENSORS; i++) z[i] = k.fired(i) ? reading_q8(t[c].z[i]) : 0;
+    uint8_t before = *k.ledState;
+    k.cycle(z, now);
+    float x = t[c].truth;
+    if (x <= 0 && episode) {
+      out.misses++;
+      episode = false;
+    }
+    if (x > STOP_CM && !episode && before == LED_OFF) {
+      episode = true;
+      entry = 0;
+    }
+    if (episode && !entry && x <= SAFE_MAX_DIST) entry = now;
+    if (before != LED_OFF || *k.ledState != LED_ON || !episode) continue;
+    // Activación: antes de cruzar, la latencia es el tiempo que faltaba
+    if (x > SAFE_MAX_DIST + speed * k.leadMs / 1000 + EARLY_MARGIN_CM) out.early++;
+    long crossing = entry ? (long)entry : (long)now + (long)((x - SAFE_MAX_DIST) / speed * 1000);
+    out.latencyMs.push_back((long)now - crossing);
+    long ttc = k.ttc();
+    if (ttc >= 0 && x > STOP_CM) out.ttcError.push_back(fabsf(ttc - x / speed * 1000) / (x / speed * 1000));
+    episode = false;
+  }
+  if (episode) out.misses++;
+  return out;
+}
+
+static float median(std::vector<float> v) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[v.size() / 2];
+}
+
+static long mean(const std::vector<long> &v) {
+  long sum = 0;
+  for (long l : v) sum += l;
+  return v.empty() ? 0 : sum / (long)v.size();
+}
+
+static void report(const Variant &k, const Outcome &o) {
+  long worst = o.latencyMs.empty() ? 0 : *std::max_element(o.latencyMs.begin(), o.latencyMs.end());
+  printf("  %-20s latencia media %5ld ms, máxima %5ld ms, %d sin activar, %d tempranas",
+         k.name, mean(o.latencyMs), worst, o.misses, o.early);
+  if (!o.ttcError.empty()) printf(", T al contacto ±%.0f %%", 100 * median(o.ttcError));
+  printf("\n");
+}
+
+int main() {
+  const float speeds[] = {10, 30, 60, 100};  // cm/s
+  for (float speed : speeds) {
+    char name[64];
+    snprintf(name, sizeof(name), "aproximación a %.0f cm/s", speed);
+    pc_scenario(name, [&]() {
+      int failed = 0;
+      std::vector<Cycle> t = make_episodes(speed, (unsigned)speed);
+      Outcome still = replay(STILL, t, speed), moving = replay(MOVING, t, speed);
+      report(STILL, still);
+      report(MOVING, moving);
+      PC_CHECK(still.misses == 0 && moving.misses == 0, "episodios sin activar");
+      PC_CHECK(still.early == 0 && moving.early == 0, "activaciones antes de tiempo");
+      PC_CHECK(mean(moving.latencyMs) <= mean(still.latencyMs), "KALMAN_CV no activa antes que el 1-D");
+      PC_CHECK(median(moving.ttcError) <= 0.2f, "tiempo al contacto con error del %.0f %%", 100 * median(moving.ttcError));
+      return failed;
+    });
+  }
+
+  printf(pcFailures ? "%d escenarios con fallos\n" : "todo correcto\n", pcFailures);
+  return pcFailures ? 1 : 0;
+}
@@ -0,0 +1,287 @@
+// ============================================================
+//  PRUEBA DE LA CAPTURA DE ECOS POR INTERRUPCIÓN (filtrokalman5.cpp)
+//  Herramienta de PC (no es un sketch): compila el sketch completo sobre
+//  nucleo_pc.h (sin KALMAN_REPLAY, que quita justo la captura), con
+//  HC-SR04 simulados que suben y bajan ECHO y disparan el ISR pin-change
+//  en el instante de cada flanco, y comprueba con las líneas DEBUG:
+//  - la distancia capturada en todo el alcance (resolución de micros())
+//  - que loop() no se queda esperando un eco (pulseIn lo retenía hasta
+//    que volvía el eco o vencía ECHO_TIMEOUT, sensor tras sensor)
+//  - que el filtro corre a 1 / READ_INTERVAL ciclos por segundo, con eco
+//    y sin él
+//  - disparo escalonado: un sensor que oye el pulso de otro se descarta
+//    (CRUCE) en cada disparo, sin descartes cuando no hay cruce (tampoco
+//    con cada sensor ante un objeto a distinta distancia), y el tiempo de
+//    adquisición por ciclo frente a escuchar los sensores en serie
+//  - peor caso del ciclo (eco que no vuelve) con la ventana limitada al
+//    alcance, y la ventana reducida con el seguimiento enganchado
+//  Sale con 1 si falla alguna comprobación.
+//
+//  Compilar: g++ -std=gnu++11 -O2 -o prueba_eco prueba_eco.cpp
+//            (con -DNO_RANGE_GATING: peor caso con la espera de ECHO_TIMEOUT)
+//  Uso:      ./prueba_eco
+// ============================================================
+
+#include <cmath>
+
+#include "nucleo_pc.h"
+#include "registro_debug.h"
+
+#define DEBUG
+#include "filtrokalman5.cpp"
+
+// Ciclos DEBUG impresos desde el instante from (µs); last recibe el último
+static int cycles_since(unsigned long from, DebugCycle &last) {
+  int n = 0;
+  for (const PcLine &l : Serial.lines) {
+    DebugCycle c;
+    if (l.us < from || !debug_parse_cycle(l.text.data(), l.text.data() + l.text.size(), c)) continue;
+    last = c;
+    n++;
+  }
+  return n;
+}
+
+// Espera de un eco que no vuelve (-DNO_RANGE_GATING: la de ECHO_TIMEOUT)
+#ifdef RANGE_GATING
+const unsigned long window = ECHO_WINDOW_US(MAX_DIST);
+#else
+const unsigned long window = ECHO_TIMEOUT;
+#endif
+
+// Arranque con los sensores del sketch y un objeto a cm (0: sin objeto)
+static void start(float cm) {
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+    pc_attach(SENSOR_PINS[i].trig, SENSOR_PINS[i].echo);
+    pcSonar[i].distanceCm = cm;
+  }
+  setup();
+}
+
+// Lo que pulseIn habría retenido loop() por ciclo: cada sensor en
+// secuencia hasta su eco, o ECHO_TIMEOUT sin él
+static unsigned long pulsein_blocking_us(float cm) {
+  unsigned long one = (cm > 0) ? 450 + pc_round_trip_us(cm) : ECHO_TIMEOUT;
+  return NUM_SENSORS * one;
+}
+
+// Líneas CRUCE: impresas por reject_crosstalk()
+static int crosstalk_lines() {
+  int n = 0;
+  for (const PcLine &l : Serial.lines) n += (l.text.compare(0, 6, "CRUCE:") == 0);
+  return n;
+}
+
+// Adquisición de cada ciclo (del disparo del primer sensor a la línea del
+// ciclo) y periodo entre comienzos de ciclo, durante us de simulación (µs)
+struct Timing {
+  unsigned long meanAcq, maxAcq, maxPeriod;
+  int cycles;
+};
+
+static Timing cycle_timing(unsigned long us) {
+  Timing t = {0, 0, 0, 0};
+  unsigned long end = pcMicros + us, total = 0, firstTrigger = 0;
+  size_t seen = Serial.lines.size();
+  while (pcMicros < end) {
+    unsigned long before = pcSonar[0].pulses;
+    loop();
+    pc_apply_crosstalk();
+    if (pcSonar[0].pulses != before) {
+      if (firstTrigger && pcSonar[0].lastPulse - firstTrigger > t.maxPeriod) t.maxPeriod = pcSonar[0].lastPulse - firstTrigger;
+      firstTrigger = pcSonar[0].lastPulse;
+    }
+    for (; seen < Serial.lines.size(); seen++) {
+      const PcLine &l = Serial.lines[seen];
+      DebugCycle c;
+      if (!debug_parse_cycle(l.text.data(), l.text.data() + l.text.size(), c)) continue;
+      unsigned long acq = l.us - firstTrigger;
+      total += acq;
+      if (acq > t.maxAcq) t.maxAcq = acq;
+      t.cycles++;
+    }
+    pc_advance_to(pcMicros + 20);
+  }
+  t.meanAcq = t.cycles ? total / t.cycles : 0;
+  return t;
+}
+
+int main() {
+  // — Distancia capturada en todo el alcance —
+  const float distances[] = {3, 10, 25, 40, 55, 64, 75, 90, 105};
+  for (float cm : distances) {
+    char name[64];
+    snprintf(name, sizeof(name), "objeto a %.0f cm", cm);
+    pc_scenario(name, [&]() {
+      int failed = 0;
+      start(cm);
+      pc_run(500000);
+      DebugCycle last;
+      int n = cycles_since(100000, last);
+      // Zona difusa: el sketch entrega la marca MAX_DIST + 1
+      bool diffuse = cm > DIFFUSE_ZONE_START && cm < DIFFUSE_ZONE_END;
+      float expected = diffuse ? MAX_DIST + 1 : cm;
+      for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+        printf("  z%u = %.2f cm\n", i + 1, last.z[i]);
+        // 4 µs de micros() son 0.07 cm; print_q8 trunca a centésimas
+        PC_CHECK(fabsf(last.z[i] - expected) <= 0.1f, "z%u = %.2f, esperado %.2f", i + 1, last.z[i], expected);
+      }
+      PC_CHECK(n == 40, "%d ciclos en 400 ms, esperados 40", n);
+      return failed;
+    });
+  }
+
+  // — loop() no se bloquea y el filtro corre a su ritmo, con eco y sin él —
+  const float ranges[] = {80, 0};
+  for (float cm : ranges) {
+    char name[64];
+    snprintf(name, sizeof(name), cm > 0 ? "ritmo con el objeto a %.0f cm" : "ritmo sin objeto", cm);
+    pc_scenario(name, [&]() {
+      int failed = 0;
+      start(cm);
+      unsigned long longest = pc_run(1000000);
+      DebugCycle last;
+      int n = cycles_since(0, last);
+      printf("  %d ciclos/s (READ_INTERVAL = %u ms), loop() retenido como mucho %lu us\n", n,
+             READ_INTERVAL, longest);
+      printf("  con pulseIn en secuencia: %lu us retenidos por ciclo\n", pulsein_blocking_us(cm));
+      // Sin eco el ciclo dura el desfase más la ventana entera: sin
+      // RANGE_GATING no cabe en READ_INTERVAL
+      if (TRIGGER_STAGGER_US * (NUM_SENSORS - 1) + window < READ_INTERVAL * 1000UL)
+        PC_CHECK(n >= 1000 / READ_INTERVAL - 1, "%d ciclos/s", n);
+      // Solo los pulsos de disparo (2 + 10 µs) y el coste del propio loop()
+      PC_CHECK(longest < 100, "loop() retenido %lu us", longest);
+      if (cm == 0) {
+        for (uint8_t i = 0; i < NUM_SENSORS; i++) PC_CHECK(last.z[i] == 0, "z%u = %.2f sin objeto", i + 1, last.z[i]);
+      }
+      return failed;
+    });
+  }
+
+  // — Cruce: el sensor 2 oye el pulso del 1 —
+  pc_scenario("cruce: el sensor 2 oye el pulso del sensor 1", []() {
+    int failed = 0;
+    start(50);
+    pcSonar[1].hearsSensor = 0;
+    pc_run(1000000);
+    DebugCycle last;
+    int n = cycles_since(0, last);
+    int rejected = 0;
+    for (const PcLine &l : Serial.lines) {
+      DebugCycle c;
+      if (debug_parse_cycle(l.text.data(), l.text.data() + l.text.size(), c) && c.z[1] == 0) rejected++;
+    }
+    // Los descartes seguidos llevan el sensor 2 a FALLADO: sale del ciclo
+    // y solo se dispara en los reintentos
+    unsigned long fired = pcSonar[1].triggers;
+    printf("  %d de %d lecturas del sensor 2 sin usar, %d líneas CRUCE en %lu disparos, z1 = %.2f, K = %.2f\n",
+           rejected, n, crosstalk_lines(), fired, last.z[0], last.k);
+    PC_CHECK(rejected == n, "%d ciclos con una lectura cruzada aceptada", n - rejected);
+    PC_CHECK(crosstalk_lines() == (int)fired, "%d líneas CRUCE para %lu disparos", crosstalk_lines(), fired);
+    PC_CHECK(fabsf(last.k - 50) < 0.2f, "K = %.2f con el sensor 1 a 50 cm", last.k);
+    return failed;
+  });
+  pc_scenario("sin cruce: ningún descarte", []() {
+    int failed = 0;
+    start(50);
+    pc_run(1000000);
+    printf("  %d líneas CRUCE\n", crosstalk_lines());
+    PC_CHECK(crosstalk_lines() == 0, "%d descartes sin cruce", crosstalk_lines());
+    return failed;
+  });
+  // Cada sensor ve su objeto: el eco propio del sensor 2 termina cerca del
+  // del 1 (el desfase anterior de 2 ms descartaba 17-52 cm de diferencia)
+  const float nearer[] = {20, 30, 40};
+  for (float diff : nearer) {
+    char name[80];
+    snprintf(name, sizeof(name), "sin cruce: el sensor 2 ve un objeto %.0f cm más cerca", diff);
+    pc_scenario(name, [&]() {
+      int failed = 0;
+      start(70);
+      pcSonar[1].distanceCm = 70 - diff;
+      pc_run(1000000);
+      DebugCycle last;
+      cycles_since(0, last);
+      printf("  %d líneas CRUCE, z2 = %.2f cm\n", crosstalk_lines(), last.z[1]);
+      PC_CHECK(crosstalk_lines() == 0, "%d descartes de un eco propio", crosstalk_lines());
+      PC_CHECK(fabsf(last.z[1] - (70 - diff)) <= 0.1f, "z2 = %.2f, esperado %.2f", last.z[1], 70 - diff);
+      return failed;
+    });
+  }
+
+  // — Adquisición escalonada frente a sensores en serie —
+  const float spans[] = {20, 60, 100};
+  for (float cm : spans) {
+    char name[64];
+    snprintf(name, sizeof(name), "adquisición con el objeto a %.0f cm", cm);
+    pc_scenario(name, [&]() {
+      int failed = 0;
+      start(cm);
+      unsigned long staggered = cycle_timing(1000000).meanAcq;
+      unsigned long serial = pulsein_blocking_us(cm);
+      unsigned long one = serial / NUM_SENSORS;
+      printf("  escalonada %lu us por ciclo, en serie %lu us (%.2f)\n", staggered, serial,
+             (double)staggered / serial);
+      // Una sola espera de eco más el desfase; cerca el desfase pesa más
+      // que el eco y la serie es más corta
+      PC_CHECK(staggered <= TRIGGER_STAGGER_US * (NUM_SENSORS - 1) + one + 100, "escalonada %lu us", staggered);
+      if (one > TRIGGER_STAGGER_US * (NUM_SENSORS - 1) + 100)
+        PC_CHECK(staggered < serial, "escalonada %lu us, en serie %lu us", staggered, serial);
+      return failed;
+    });
+  }
+
+  // — Peor caso del ciclo: eco que no vuelve dentro del alcance —
+  // Objeto más allá del alcance (su eco llega tarde) y sin objeto (ECHO
+  // alto ~38 ms). Con -DNO_RANGE_GATING se mide la espera de ECHO_TIMEOUT.
+  const float lost[] = {200, 0};
+  for (float cm : lost) {
+    char name[80];
+    snprintf(name, sizeof(name), cm > 0 ? "peor caso: objeto a %.0f cm, fuera de alcance" : "peor caso: sin objeto", cm);
+    pc_scenario(name, [&]() {
+      int failed = 0;
+      start(cm);
+      Timing t = cycle_timing(2000000);
+      printf("  ventana %lu us: adquisición media %lu us, máxima %lu us; periodo del ciclo máximo %lu us\n", window,
+             t.meanAcq, t.maxAcq, t.maxPeriod);
+      PC_CHECK(t.maxAcq <= TRIGGER_STAGGER_US * (NUM_SENSORS - 1) + window + 100, "adquisición %lu us", t.maxAcq);
+      #ifdef RANGE_GATING
+        PC_CHECK(t.maxPeriod <= READ_INTERVAL * 1000UL + 100, "periodo %lu us", t.maxPeriod);
+      #endif
+      return failed;
+    });
+  }
+
+  #ifdef RANGE_GATING
+  // — Seguimiento enganchado: ventana reducida y liberación sin eco —
+  pc_scenario("seguimiento enganchado a 40 cm, el objeto salta a 100 cm", []() {
+    int failed = 0;
+    start(40);
+    Timing locked = cycle_timing(1000000);
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) pcSonar[i].distanceCm = 100;
+    size_t from = Serial.lines.size();
+    cycle_timing(200000);
+    // Ciclos hasta volver a leer el objeto (lecturas de 100 cm)
+    int reacquire = -1, k = 0;
+    for (size_t i = from; i < Serial.lines.size() && reacquire < 0; i++) {
+      const PcLine &l = Serial.lines[i];
+      DebugCycle c;
+      if (!debug_parse_cycle(l.text.data(), l.text.data() + l.text.size(), c)) continue;
+      k++;
+      if (fabsf(c.z[0] - 100) < 0.2f) reacquire = k;
+    }
+    printf("  enganchado: adquisición media %lu us (ventana %u us); tras el salto %d ciclos hasta leer 100 cm\n",
+           locked.meanAcq, ECHO_WINDOW_US(40 + TRACK_GATE), reacquire);
+    PC_CHECK(locked.maxAcq <= TRIGGER_STAGGER_US * (NUM_SENSORS - 1) + ECHO_WINDOW_US(40 + TRACK_GATE) + 100,
+             "adquisición enganchada %lu us", locked.maxAcq);
+    // Un ciclo sin eco en la ventana reducida lo tapa la mediana de 3 (el
+    // seguimiento sigue un ciclo más), otro lo entrega ya sin eco y la
+    // mediana necesita dos lecturas nuevas
+    PC_CHECK(reacquire > 0 && reacquire <= 4, "%d ciclos hasta leer el objeto tras soltar el seguimiento", reacquire);
+    return failed;
+  });
+  #endif
+
+  printf(pcFailures ? "%d escenarios con fallos\n" : "todo correcto\n", pcFailures);
+  return pcFailures ? 1 : 0;
+}
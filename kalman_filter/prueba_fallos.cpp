@@ -0,0 +1,169 @@
+// ============================================================
+//  PRUEBA DE FALLOS DE SENSOR: COMPUERTA DE INNOVACIÓN Y SALUD
+//  Herramienta de PC (no es un sketch): compila el sketch completo sobre
+//  nucleo_pc.h (como prueba_eco.cpp) con dos HC-SR04 simulados, ruido de
+//  0.3 cm por ciclo y un objeto a 90 cm, e inyecta fallos a los 2 s:
+//  - arranque: el objeto ya está a 90 cm al encender (kalman_x0 = 10 cm);
+//    ciclos hasta seguirlo, lecturas rechazadas y sensores SOSPECHOSOS
+//  - el sensor 2 se queda pegado a 20 cm
+//  - ecos espurios (5 % de las lecturas de cada sensor, 10-40 cm cortas)
+//  - el pin ECHO del sensor 2 muere: nunca sube
+//  Por fallo, error cuadrático medio y máximo de la estimación desde 1 s
+//  después del fallo, estado final de salud y disparos de cada sensor.
+//  Sale con 1 si falla alguna comprobación.
+//
+//  Compilar: g++ -std=gnu++11 -O2 -o prueba_fallos prueba_fallos.cpp
+//            (con -DNO_INNOVATION_GATING: los mismos fallos sin compuerta)
+//  Uso:      ./prueba_fallos
+// ============================================================
+
+#include <cmath>
+#include <random>
+
+#include "nucleo_pc.h"
+#include "registro_debug.h"
+
+#define DEBUG
+#include "filtrokalman5.cpp"
+
+#define OBJECT_CM 90.0f
+#define SIGMA_CM 0.3f
+#define FAULT_MS 2000
+#define SETTLE_MS 1000   // tras el fallo, antes de medir el error
+#define END_MS 8000
+
+static const char *HEALTH_NAMES[] = {"OK", "SOSPECHOSO", "FALLADO"};
+
+// Lecturas de un ciclo: cm de cada sensor antes del ruido (<= 0: sin objeto)
+typedef void (*Fault)(float cm[], std::mt19937 &rng);
+
+static void stuck(float cm[], std::mt19937 &) { cm[1] = 20; }
+
+static void spikes(float cm[], std::mt19937 &rng) {
+  std::uniform_real_distribution<float> u(0, 1);
+  for (uint8_t i = 0; i < NUM_SENSORS; i++)
+    if (u(rng) < 0.05f) cm[i] -= 10 + 30 * u(rng);
+}
+
+static void dead_pin(float[], std::mt19937 &) { pcSonar[1].dead = true; }
+
+struct Outcome {
+  double rms, worst;        // cm, desde FAULT_MS + SETTLE_MS
+  unsigned long triggers[NUM_SENSORS];
+};
+
+// Corre END_MS con el objeto quieto (fault desde FAULT_MS, si hay) y mide
+// la estimación de cada línea DEBUG
+static Outcome run(Fault fault) {
+  Outcome o = {0, 0, {0}};
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) pc_attach(SENSOR_PINS[i].trig, SENSOR_PINS[i].echo);
+  setup();
+  std::mt19937 rng(14);
+  std::normal_distribution<float> noise(0, SIGMA_CM);
+  unsigned long from[NUM_SENSORS] = {0};
+  double sum = 0;
+  unsigned n = 0;
+  size_t seen = 0;
+  for (unsigned long ms = 0; ms < END_MS; ms += READ_INTERVAL) {
+    float cm[NUM_SENSORS];
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) cm[i] = OBJECT_CM;
+    if (fault && ms == FAULT_MS)
+      for (uint8_t i = 0; i < NUM_SENSORS; i++) from[i] = pcSonar[i].triggers;
+    if (fault && ms >= FAULT_MS) fault(cm, rng);
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) pcSonar[i].distanceCm = cm[i] + noise(rng);
+    pc_run(READ_INTERVAL * 1000UL);
+    for (; seen < Serial.lines.size(); seen++) {
+      const PcLine &l = Serial.lines[seen];
+      DebugCycle c;
+      if (l.us < (FAULT_MS + SETTLE_MS) * 1000UL) continue;
+      if (!debug_parse_cycle(l.text.data(), l.text.data() + l.text.size(), c)) continue;
+      double e = c.k - OBJECT_CM;
+      sum += e * e;
+      o.worst = fmax(o.worst, fabs(e));
+      n++;
+    }
+  }
+  o.rms = sqrt(sum / n);
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) o.triggers[i] = pcSonar[i].triggers - from[i];
+  printf("  error RMS %.2f cm, máximo %.2f cm; salud %s/%s; disparos desde el fallo %lu/%lu\n", o.rms, o.worst,
+         HEALTH_NAMES[sensorHealth[0]], HEALTH_NAMES[sensorHealth[1]], o.triggers[0], o.triggers[1]);
+  return o;
+}
+
+int main() {
+  // — Arranque con el objeto ya delante —
+  pc_scenario("arranque con el objeto a 90 cm", []() {
+    int failed = 0;
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+      pc_attach(SENSOR_PINS[i].trig, SENSOR_PINS[i].echo);
+      pcSonar[i].distanceCm = OBJECT_CM;
+    }
+    setup();
+    pc_run(1000000);
+    int cycles = 0, locked = -1, rejected = 0, health = 0;
+    for (const PcLine &l : Serial.lines) {
+      health += (l.text.compare(0, 7, "SENSOR ") == 0);
+      DebugCycle c;
+      if (!debug_parse_cycle(l.text.data(), l.text.data() + l.text.size(), c)) continue;
+      cycles++;
+      for (uint8_t i = 0; i < c.sensors; i++) rejected += c.rejected[i];
+      if (locked < 0 && fabsf(c.k - OBJECT_CM) < 1) locked = cycles;
+    }
+    printf("  %d ciclos hasta seguir el objeto (±1 cm), %d lecturas rechazadas, %d cambios de salud\n", locked,
+           rejected, health);
+    #ifdef INNOVATION_GATING
+      // La primera lectura re-adquiere; la mediana de 3 la entrega en el
+      // segundo ciclo (sin compuerta P arranca pequeña y tarda más)
+      PC_CHECK(locked > 0 && locked <= 3, "%d ciclos hasta seguir el objeto", locked);
+    #endif
+    PC_CHECK(rejected == 0, "%d lecturas rechazadas al arrancar", rejected);
+    PC_CHECK(health == 0, "%d sensores cambian de salud al arrancar", health);
+    return failed;
+  });
+
+  pc_scenario("sin fallos", []() {
+    int failed = 0;
+    Outcome o = run(0);
+    PC_CHECK(o.rms < 0.3, "error RMS %.2f cm", o.rms);
+    PC_CHECK(sensorHealth[0] == SENSOR_OK && sensorHealth[1] == SENSOR_OK, "un sensor sano no está OK");
+    return failed;
+  });
+
+  pc_scenario("sensor 2 pegado a 20 cm", []() {
+    int failed = 0;
+    #ifdef INNOVATION_GATING
+      Outcome o = run(stuck);
+      PC_CHECK(o.rms < 0.5, "error RMS %.2f cm", o.rms);
+      PC_CHECK(sensorHealth[1] == SENSOR_FAILED, "el sensor 2 sigue %s", HEALTH_NAMES[sensorHealth[1]]);
+      PC_CHECK(sensorHealth[0] == SENSOR_OK, "el sensor 1 está %s", HEALTH_NAMES[sensorHealth[0]]);
+    #else
+      run(stuck);  // sin compuerta solo se mide
+    #endif
+    return failed;
+  });
+
+  pc_scenario("ecos espurios en el 5 % de las lecturas", []() {
+    int failed = 0;
+    #ifdef INNOVATION_GATING
+      Outcome o = run(spikes);
+      PC_CHECK(o.worst < 1, "error máximo %.2f cm", o.worst);
+    #else
+      run(spikes);
+    #endif
+    PC_CHECK(sensorHealth[0] != SENSOR_FAILED && sensorHealth[1] != SENSOR_FAILED, "un sensor con ecos sueltos, FALLADO");
+    return failed;
+  });
+
+  pc_scenario("pin ECHO del sensor 2 muerto", []() {
+    int failed = 0;
+    Outcome o = run(dead_pin);
+    PC_CHECK(o.rms < 0.5, "error RMS %.2f cm", o.rms);
+    PC_CHECK(sensorHealth[1] == SENSOR_FAILED, "el sensor 2 sigue %s", HEALTH_NAMES[sensorHealth[1]]);
+    // FALLADO solo se dispara en los reintentos (uno por HEALTH_RETRY_MS)
+    PC_CHECK(o.triggers[1] < o.triggers[0] / 2, "sensor 2 disparado %lu veces", o.triggers[1]);
+    return failed;
+  });
+
+  printf(pcFailures ? "%d escenarios con fallos\n" : "todo correcto\n", pcFailures);
+  return pcFailures ? 1 : 0;
+}
@@ -0,0 +1,519 @@
+// ============================================================
+//  PRUEBA DE kalman.h EN EL PC
+//  Herramienta de PC (no es un sketch): cada instancia de KalmanFilter
+//  que usan los sketches frente al código escrito a mano que sustituyó
+//  (filtrokalman3.cpp en float, filtrokalman5.cpp en décimas y el modo
+//  KALMAN_CV en Q16.16), con las mismas lecturas aleatorias:
+//  - el resultado debe ser idéntico bit a bit, ciclo a ciclo
+//  - tiempo por actualización en el PC de cada forma (no son ciclos del
+//    AVR; el tamaño en flash sigue sin medir)
+//  Y la fusión en forma de información (update_fused) frente a la
+//  actualización secuencial, con 2 y 4 sensores en los tres tipos: las dos
+//  frente al resultado exacto en double de cada caso aleatorio, y su
+//  tiempo en el PC.
+//  Y la tabla de ganancias de TenthsTable frente a la aritmética, en todos
+//  los pares (P, R) de 0..255 x 0..255, y que desde cualquier P fuera de
+//  la tabla dos actualizaciones vuelven a ella.
+//  Y q16_mul32/q16_div32 (solo 32 bits, las del AVR) frente a q16_mul/q16_div
+//  con intermedio de 64 bits (las del PC), y P en décimas sin eco durante mucho tiempo (satura, no vuelve a 0).
+//  Sale con 1 si falla alguna comprobación.
+//
+//  Compilar: g++ -std=gnu++11 -O2 -o prueba_kalman prueba_kalman.cpp
+//  Uso:      ./prueba_kalman
+// ============================================================
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#define KALMAN_REPLAY
+#include "nucleo_pc.h"
+#include "kalman.h"
+
+#define CYCLES 1000000
+#define TIMING_ROUNDS 5
+
+// Tiempo medio por llamada de f(c) para c en 0..CYCLES-1 (ns en el PC)
+template <typename F>
+static double ns_per_cycle(F f) {
+  double best = 1e9;
+  for (int r = 0; r < TIMING_ROUNDS; r++) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t c = 0; c < CYCLES; c++) f(c);
+    auto t1 = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / CYCLES;
+    if (ns < best) best = ns;
+  }
+  return best;
+}
+
+static void report_timing(double manual, double engine) {
+  printf("  PC: a mano %.1f ns, KalmanFilter %.1f ns por ciclo\n", manual, engine);
+}
+
+// — Referencias: el filtro a mano de cada sketch antes de kalman.h —
+
+// filtrokalman3.cpp: float, dos lecturas secuenciales (z <= 0: sin eco)
+struct ManualFloat {
+  float x = 10, p = 1, q = 0.01f;
+  void cycle(const float z[2], const float r[2]) {
+    p += q;
+    for (int i = 0; i < 2; i++) {
+      if (z[i] <= 0) continue;
+      float k = p / (p + r[i]);
+      x += k * (z[i] - x);
+      p *= (1 - k);
+    }
+  }
+};
+
+// filtrokalman5.cpp: x en Q8.8, P, q y R en décimas
+struct ManualTenths {
+  uint16_t x = 10 << 8;
+  uint8_t p = 10, q = 1;
+  void cycle(const uint16_t z[2], const uint8_t r[2]) {
+    p += q;
+    for (int i = 0; i < 2; i++) {
+      if (z[i] == 0) continue;
+      uint16_t denominator = p + r[i];
+      uint8_t k = (denominator > 0) ? ((10 * p) / denominator) : 0;
+      int32_t innovation = ((int32_t)z[i] - (int32_t)x);
+      x += (k * innovation) / 10;
+      p = (p * (10 - k)) / 10;
+    }
+  }
+};
+
+// filtrokalman5.cpp con KALMAN_CV: [posición, velocidad] en Q16.16
+struct ManualCv {
+  int32_t x = 50 * Q16_ONE, v = 0, p00 = 100 * Q16_ONE, p01 = 0, p11 = 10000 * Q16_ONE;
+  int32_t dt = Q16_ONE / 100, q00 = 3, q01 = 655, q11 = 262144;
+  void cycle(const int32_t z[2], const int32_t r[2]) {
+    x += q16_mul(v, dt);
+    int32_t dt_p11 = q16_mul(dt, p11);
+    p00 += q16_mul(dt, 2 * p01 + dt_p11) + q00;
+    p01 += dt_p11 + q01;
+    p11 += q11;
+    for (int i = 0; i < 2; i++) {
+      if (z[i] <= 0) continue;
+      int32_t s = p00 + r[i];
+      int32_t k0 = q16_div(p00, s);
+      int32_t k1 = q16_div(p01, s);
+      int32_t innovation = z[i] - x;
+      x += q16_mul(k0, innovation);
+      v += q16_mul(k1, innovation);
+      int32_t p01_prev = p01;
+      p11 -= q16_mul(k1, p01_prev);
+      p01 -= q16_mul(k0, p01_prev);
+      p00 -= q16_mul(k0, p00);
+    }
+  }
+};
+
+// Lecturas de dos sensores alrededor de un objeto que se mueve despacio,
+// con un 5 % sin eco; r cambia de vez en cuando como con el ruido adaptativo
+struct Reading {
+  float z[2];
+  float r[2];
+};
+
+static std::vector<Reading> make_readings() {
+  std::vector<Reading> t(CYCLES);
+  std::mt19937 rng(9);
+  std::normal_distribution<float> noise(0, 0.5f);
+  std::uniform_real_distribution<float> u(0, 1);
+  float d = 50, r[2] = {0.5f, 0.5f};
+  for (uint32_t c = 0; c < CYCLES; c++) {
+    d += 0.05f * (u(rng) - 0.5f);
+    if (d < 5 || d > 100) d = 50;
+    for (int i = 0; i < 2; i++) {
+      if (u(rng) < 0.01f) r[i] = 0.1f + 1.9f * u(rng);
+      t[c].z[i] = (u(rng) < 0.05f) ? 0 : d + noise(rng);
+      t[c].r[i] = r[i];
+    }
+  }
+  return t;
+}
+
+// — Fusión en forma de información frente a la actualización secuencial —
+// Unidades de cada tipo: los casos se generan con valores representables
+// en todos (z en Q8.8, P y r en décimas) para comparar contra el mismo exacto
+template <typename T>
+struct Units;
+
+template <>
+struct Units<float> {
+  static const char *name() { return "float"; }
+  static float state(uint16_t z_q8) { return z_q8 / 256.0f; }
+  static float cov(uint8_t x10) { return x10 / 10.0f; }
+  static float info(uint8_t r_x10) { return 10.0f / r_x10; }
+  static double cm(float x) { return x; }
+  static double var(float p) { return p; }
+};
+
+// 1/r en Q12 como INFO_Q12_TABLE de filtrokalman5.cpp
+static uint16_t info_q12(uint8_t r_x10) { return (KALMAN_INFO_ONE + r_x10 / 2) / r_x10; }
+
+template <>
+struct Units<Q16> {
+  static const char *name() { return "Q16.16"; }
+  static int32_t state(uint16_t z_q8) { return (int32_t)z_q8 << 8; }
+  static Q16 cov(uint8_t x10) { Q16 t = {x10 * (int32_t)(Q16_ONE / 10)}; return t; }
+  static int32_t info(uint8_t r_x10) { return (int32_t)info_q12(r_x10) * (10 * Q16_ONE / KALMAN_INFO_ONE); }
+  static double cm(int32_t x) { return x / 65536.0; }
+  static double var(Q16 p) { return p.v / 65536.0; }
+};
+
+template <>
+struct Units<Tenths> {
+  static const char *name() { return "décimas"; }
+  static uint16_t state(uint16_t z_q8) { return z_q8; }
+  static Tenths cov(uint8_t x10) { Tenths t = {x10}; return t; }
+  static uint16_t info(uint8_t r_x10) { return info_q12(r_x10); }
+  static double cm(uint16_t x) { return x / 256.0; }
+  static double var(Tenths p) { return p.v / 10.0; }
+};
+
+#define FUSION_CASES 200000
+#define FUSION_X0_Q8 (50 << 8)
+
+// Un caso: P previa y N lecturas (0 sin eco) con su r, en décimas y Q8.8
+template <uint8_t N>
+struct FusionCase {
+  uint8_t p_x10;
+  uint16_t z[N];
+  uint8_t r_x10[N];
+};
+
+template <uint8_t N>
+static std::vector<FusionCase<N> > make_fusion_cases() {
+  std::vector<FusionCase<N> > cases(FUSION_CASES);
+  std::mt19937 rng(N);
+  std::normal_distribution<float> noise(0, 1);
+  std::uniform_int_distribution<int> p(1, 40), r(1, KALMAN_GAIN_R_MAX);
+  std::uniform_real_distribution<float> u(0, 1);
+  for (FusionCase<N> &c : cases) {
+    c.p_x10 = p(rng);
+    for (uint8_t i = 0; i < N; i++) {
+      c.z[i] = (u(rng) < 0.1f) ? 0 : (uint16_t)(FUSION_X0_Q8 + 256 * noise(rng));
+      c.r_x10[i] = r(rng);
+    }
+  }
+  return cases;
+}
+
+struct FusionError {
+  double x, p;  // error máximo frente al exacto (cm, cm²)
+  double ns;    // tiempo por actualización en el PC
+};
+
+// Las dos formas sobre los mismos casos, frente al exacto en double
+template <typename T, uint8_t N>
+static void fusion_errors(const std::vector<FusionCase<N> > &cases, FusionError &seq, FusionError &fused) {
+  typedef Units<T> U;
+  typedef KalmanFilter<T, 1, N> Filter;
+  std::vector<typename Filter::X> z(N * cases.size());
+  std::vector<T> r(N * cases.size());
+  std::vector<typename KalmanScalar<T>::info_type> w(N * cases.size());
+  for (size_t c = 0; c < cases.size(); c++) {
+    for (uint8_t i = 0; i < N; i++) {
+      z[N * c + i] = cases[c].z[i] ? U::state(cases[c].z[i]) : 0;
+      r[N * c + i] = U::cov(cases[c].r_x10[i]);
+      w[N * c + i] = U::info(cases[c].r_x10[i]);
+    }
+  }
+  Filter k(U::state(FUSION_X0_Q8), U::cov(0), U::cov(0));
+  seq = fused = FusionError();
+  for (size_t c = 0; c < cases.size(); c++) {
+    // Exacto: P⁻¹ += Σ 1/r_i, x += P·Σ (z_i - x)/r_i
+    double info = 10.0 / cases[c].p_x10, pull = 0;
+    for (uint8_t i = 0; i < N; i++) {
+      if (!cases[c].z[i]) continue;
+      info += 10.0 / cases[c].r_x10[i];
+      pull += (cases[c].z[i] - FUSION_X0_Q8) / 256.0 * 10.0 / cases[c].r_x10[i];
+    }
+    double p = 1 / info, x = FUSION_X0_Q8 / 256.0 + p * pull;
+    for (int form = 0; form < 2; form++) {
+      k.x = U::state(FUSION_X0_Q8);
+      k.p = U::cov(cases[c].p_x10);
+      if (form) k.update_fused(&z[N * c], &w[N * c]);
+      else k.update(&z[N * c], &r[N * c]);
+      FusionError &e = form ? fused : seq;
+      e.x = fmax(e.x, fabs(U::cm(k.x) - x));
+      e.p = fmax(e.p, fabs(U::var(k.p) - p));
+    }
+  }
+  volatile double sink = 0;
+  for (int form = 0; form < 2; form++) {
+    double best = 1e9;
+    for (int round = 0; round < TIMING_ROUNDS; round++) {
+      auto t0 = std::chrono::steady_clock::now();
+      for (size_t c = 0; c < cases.size(); c++) {
+        k.x = U::state(FUSION_X0_Q8);
+        k.p = U::cov(cases[c].p_x10);
+        if (form) k.update_fused(&z[N * c], &w[N * c]);
+        else k.update(&z[N * c], &r[N * c]);
+        sink = U::cm(k.x);
+      }
+      auto t1 = std::chrono::steady_clock::now();
+      best = fmin(best, std::chrono::duration<double, std::nano>(t1 - t0).count() / cases.size());
+    }
+    (form ? fused : seq).ns = best;
+  }
+  (void)sink;
+}
+
+// Comprueba un tipo con N sensores; tolX y tolP acotan el error de la fusión
+template <typename T, uint8_t N>
+static int check_fusion(const std::vector<FusionCase<N> > &cases, double tolX, double tolP) {
+  int failed = 0;
+  FusionError seq, fused;
+  fusion_errors<T, N>(cases, seq, fused);
+  printf("  %-8s %u sensores: secuencial x ±%.5f cm P ±%.5f cm² %5.1f ns, fusión x ±%.5f cm P ±%.5f cm² %5.1f ns\n",
+         Units<T>::name(), N, seq.x, seq.p, seq.ns, fused.x, fused.p, fused.ns);
+  PC_CHECK(fused.x <= tolX && fused.p <= tolP, "%s, %u sensores: fusión fuera de tolerancia", Units<T>::name(), N);
+  return failed;
+}
+
+int main() {
+  const std::vector<Reading> in = make_readings();
+
+  pc_scenario("float 1D (filtrokalman3.cpp)", [&]() {
+    int failed = 0;
+    ManualFloat manual;
+    KalmanFilter<float, 1, 2> engine(10, 1, 0.01f);
+    for (uint32_t c = 0; c < CYCLES && !failed; c++) {
+      manual.cycle(in[c].z, in[c].r);
+      engine.predict();
+      engine.update(in[c].z, in[c].r);
+      PC_CHECK(memcmp(&manual.x, &engine.x, sizeof(float)) == 0 && memcmp(&manual.p, &engine.p, sizeof(float)) == 0,
+               "ciclo %u: a mano x=%.9g p=%.9g, KalmanFilter x=%.9g p=%.9g", c, manual.x, manual.p, engine.x, engine.p);
+    }
+    volatile float sink = 0;
+    double a = ns_per_cycle([&](uint32_t c) { manual.cycle(in[c].z, in[c].r); sink = manual.x; });
+    double b = ns_per_cycle([&](uint32_t c) { engine.predict(); engine.update(in[c].z, in[c].r); sink = engine.x; });
+    report_timing(a, b);
+    return failed;
+  });
+
+  // Las mismas lecturas en las unidades de cada sketch
+  std::vector<uint16_t> zq8(2 * CYCLES);
+  std::vector<uint8_t> rx10(2 * CYCLES);
+  std::vector<int32_t> zq16(2 * CYCLES), rq16(2 * CYCLES);
+  std::vector<Tenths> rt(2 * CYCLES);
+  std::vector<Q16> rq(2 * CYCLES);
+  for (uint32_t c = 0; c < CYCLES; c++) {
+    for (int i = 0; i < 2; i++) {
+      zq8[2 * c + i] = (uint16_t)(in[c].z[i] * 256);
+      rx10[2 * c + i] = (uint8_t)(in[c].r[i] * 10 + 0.5f);
+      zq16[2 * c + i] = (int32_t)(in[c].z[i] * Q16_ONE);
+      rq16[2 * c + i] = (int32_t)(in[c].r[i] * Q16_ONE);
+      rt[2 * c + i].v = rx10[2 * c + i];
+      rq[2 * c + i].v = rq16[2 * c + i];
+    }
+  }
+
+  pc_scenario("décimas 1D (filtrokalman5.cpp)", [&]() {
+    int failed = 0;
+    ManualTenths manual;
+    Tenths p0 = {10}, q0 = {1};
+    KalmanFilter<Tenths, 1, 2> engine(10 << 8, p0, q0);
+    for (uint32_t c = 0; c < CYCLES && !failed; c++) {
+      manual.cycle(&zq8[2 * c], &rx10[2 * c]);
+      engine.predict();
+      engine.update(&zq8[2 * c], &rt[2 * c]);
+      PC_CHECK(manual.x == engine.x && manual.p == engine.p.v, "ciclo %u: a mano x=%u p=%u, KalmanFilter x=%u p=%u",
+               c, manual.x, manual.p, engine.x, engine.p.v);
+    }
+    volatile uint16_t sink = 0;
+    double a = ns_per_cycle([&](uint32_t c) { manual.cycle(&zq8[2 * c], &rx10[2 * c]); sink = manual.x; });
+    double b = ns_per_cycle([&](uint32_t c) {
+      engine.predict();
+      engine.update(&zq8[2 * c], &rt[2 * c]);
+      sink = engine.x;
+    });
+    report_timing(a, b);
+    return failed;
+  });
+
+  pc_scenario("Q16.16 velocidad constante (KALMAN_CV)", [&]() {
+    int failed = 0;
+    ManualCv manual;
+    Q16 p00 = {manual.p00}, p11 = {manual.p11}, dt = {manual.dt};
+    Q16 q00 = {manual.q00}, q01 = {manual.q01}, q11 = {manual.q11};
+    KalmanFilter<Q16, 2, 2> engine(manual.x, p00, p11, dt, q00, q01, q11);
+    for (uint32_t c = 0; c < CYCLES && !failed; c++) {
+      manual.cycle(&zq16[2 * c], &rq16[2 * c]);
+      engine.predict();
+      engine.update(&zq16[2 * c], &rq[2 * c]);
+      PC_CHECK(manual.x == engine.x && manual.v == engine.v && manual.p00 == engine.p00.v &&
+               manual.p01 == engine.p01.v && manual.p11 == engine.p11.v,
+               "ciclo %u: a mano x=%d v=%d, KalmanFilter x=%d v=%d", c, manual.x, manual.v, engine.x, engine.v);
+    }
+    volatile int32_t sink = 0;
+    double a = ns_per_cycle([&](uint32_t c) { manual.cycle(&zq16[2 * c], &rq16[2 * c]); sink = manual.x; });
+    double b = ns_per_cycle([&](uint32_t c) {
+      engine.predict();
+      engine.update(&zq16[2 * c], &rq[2 * c]);
+      sink = engine.x;
+    });
+    report_timing(a, b);
+    return failed;
+  });
+
+  pc_scenario("fusión en forma de información frente a secuencial", []() {
+    int failed = 0;
+    std::vector<FusionCase<2> > two = make_fusion_cases<2>();
+    std::vector<FusionCase<4> > four = make_fusion_cases<4>();
+    failed += check_fusion<float, 2>(two, 1e-4, 1e-5);
+    failed += check_fusion<float, 4>(four, 1e-4, 1e-5);
+    // 1/r sale de INFO_Q12_TABLE: en Q16.16 la fusión hereda su redondeo
+    failed += check_fusion<Q16, 2>(two, 5e-3, 5e-3);
+    failed += check_fusion<Q16, 4>(four, 5e-3, 5e-3);
+    // P' en décimas enteras: ±0.1 cm² como poco
+    failed += check_fusion<Tenths, 2>(two, 0.05, 0.15);
+    failed += check_fusion<Tenths, 4>(four, 0.05, 0.15);
+    return failed;
+  });
+
+  pc_scenario("tabla de ganancias (TenthsTable) frente a la aritmética", []() {
+    int failed = 0;
+    // Exhaustivo: K y P' de cada par, y el paso completo con innovaciones
+    // de ambos signos (la tabla solo cubre P <= 15, R <= 20; el resto
+    // debe caer en la aritmética)
+    const int16_t innovations[] = {-0x7000, -2560, -256, -1, 0, 1, 255, 2560, 0x7000};
+    uint32_t pairs = 0, mismatches = 0;
+    for (uint16_t p = 0; p <= 255; p++) {
+      for (uint16_t r = 0; r <= 255; r++) {
+        TenthsGain a = tenths_gain(p, r), b = TenthsGainPolicy<true>::gain(p, r);
+        bool same = (a.k == b.k && a.p == b.p);
+        for (int16_t e : innovations) {
+          Tenths pa = {(uint8_t)p}, ra = {(uint8_t)r};
+          TenthsTable pb = {(uint8_t)p}, rb = {(uint8_t)r};
+          KalmanFilter<Tenths, 1, 1> fa(0x8000, pa, pa);
+          KalmanFilter<TenthsTable, 1, 1> fb(0x8000, pb, pb);
+          uint16_t z = 0x8000 + e;
+          fa.update_one(z, ra);
+          fb.update_one(z, rb);
+          same = same && fa.x == fb.x && fa.p.v == fb.p.v;
+        }
+        pairs++;
+        if (!same) {
+          if (!mismatches) printf("  primer fallo: P=%u R=%u: K %u/%u, P' %u/%u\n", p, r, a.k, b.k, a.p, b.p);
+          mismatches++;
+        }
+      }
+    }
+    printf("  %u pares (P, R), %u distintos\n", pairs, mismatches);
+    PC_CHECK(mismatches == 0, "la tabla no coincide con la aritmética");
+    // Fuera de la tabla (P > 1.5 tras re-adquirir o sin eco, hasta 25.5):
+    // desde cualquier P, dos actualizaciones con cualquier R del rango
+    // adaptativo vuelven a ella
+    uint16_t worst = 0;
+    for (uint16_t p = 0; p <= 255; p++) {
+      for (uint16_t r1 = 1; r1 <= KALMAN_GAIN_R_MAX; r1++) {
+        for (uint16_t r2 = 1; r2 <= KALMAN_GAIN_R_MAX; r2++) {
+          uint8_t after = tenths_gain(tenths_gain(p, r1).p, r2).p;
+          if (after > worst) worst = after;
+        }
+      }
+    }
+    printf("  P' máxima tras dos actualizaciones desde P <= 255: %u (tabla hasta %u)\n", worst, KALMAN_GAIN_P_MAX);
+    PC_CHECK(worst <= KALMAN_GAIN_P_MAX, "dos actualizaciones dejan P' = %u fuera de la tabla", worst);
+    // Coste en el PC dentro del dominio de la tabla (no son ciclos del AVR)
+    volatile uint8_t sink = 0;
+    double a = ns_per_cycle([&](uint32_t c) {
+      TenthsGain g = tenths_gain(c & 15, 1 + (c >> 4) % 20);
+      sink = g.k + g.p;
+    });
+    double b = ns_per_cycle([&](uint32_t c) {
+      TenthsGain g = TenthsGainPolicy<true>::gain(c & 15, 1 + (c >> 4) % 20);
+      sink = g.k + g.p;
+    });
+    printf("  PC: aritmética %.2f ns, tabla %.2f ns por ganancia\n", a, b);
+    return failed;
+  });
+
+  pc_scenario("q16_mul32 y q16_div32 (AVR) frente a 64 bits (PC)", []() {
+    int failed = 0;
+    // Referencias sin truncar a int32_t, para saber qué resultados caben
+    auto mul64 = [](int32_t a, int32_t b) { return ((int64_t)a * b + (Q16_ONE / 2)) >> 16; };
+    auto div64 = [](int32_t a, int32_t b) { return ((int64_t)a << 16) / b; };
+    // Operandos de todas las magnitudes (exponente aleatorio) y los extremos
+    std::mt19937 rng(12);
+    auto operand = [&]() {
+      int bits = rng() % 32;
+      int32_t v = (int32_t)(rng() >> (31 - bits)) >> 1;
+      return (rng() & 1) ? v : -v;
+    };
+    const int32_t edges[] = {0, 1, -1, 0x7FFF, 0x8000, -0x8000, 0xFFFF, 0x10000, -0x10000,
+                             0x7FFFFFFF, -0x7FFFFFFF, (int32_t)0x80000000};
+    uint64_t mulChecked = 0, divChecked = 0, mulBad = 0, divBad = 0;
+    auto check = [&](int32_t a, int32_t b) {
+      int64_t m = mul64(a, b);
+      if (m >= INT32_MIN && m <= INT32_MAX) {
+        mulChecked++;
+        if (q16_mul32(a, b) != m && !mulBad++)
+          printf("  q16_mul32(%d, %d) = %d, 64 bits %lld\n", a, b, q16_mul32(a, b), (long long)m);
+        if (q16_mul(a, b) != m && !mulBad++) printf("  q16_mul(%d, %d) = %d\n", a, b, q16_mul(a, b));
+      }
+      if (b == 0) return;
+      int64_t d = div64(a, b);
+      if (d >= INT32_MIN && d <= INT32_MAX) {
+        divChecked++;
+        if (q16_div32(a, b) != d && !divBad++)
+          printf("  q16_div32(%d, %d) = %d, 64 bits %lld\n", a, b, q16_div32(a, b), (long long)d);
+        if (q16_div(a, b) != d && !divBad++) printf("  q16_div(%d, %d) = %d\n", a, b, q16_div(a, b));
+      }
+    };
+    for (int32_t a : edges)
+      for (int32_t b : edges) check(a, b);
+    for (uint32_t i = 0; i < 20 * CYCLES; i++) {
+      int32_t a = operand(), b = operand();
+      check(a, b);
+      check(a, edges[i % 12]);
+    }
+    printf("  %llu productos y %llu cocientes en rango, %llu y %llu distintos\n", (unsigned long long)mulChecked,
+           (unsigned long long)divChecked, (unsigned long long)mulBad, (unsigned long long)divBad);
+    PC_CHECK(mulBad == 0 && divBad == 0, "no coinciden con la versión de 64 bits");
+    // Coste en el PC, donde el intermedio de 64 bits es nativo (no son
+    // ciclos del AVR); el divisor es mayor que el dividendo, como en K = P/S
+    std::vector<int32_t> op(2 * CYCLES);
+    for (int32_t &v : op) v = (int32_t)(rng() % (200 * Q16_ONE)) + 1;
+    volatile int64_t sink = 0;
+    double m32 = ns_per_cycle([&](uint32_t c) { sink = q16_mul32(op[2 * c], op[2 * c + 1] >> 8); });
+    double m64 = ns_per_cycle([&](uint32_t c) { sink = q16_mul(op[2 * c], op[2 * c + 1] >> 8); });
+    double d32 = ns_per_cycle([&](uint32_t c) { sink = q16_div32(op[2 * c] >> 8, op[2 * c + 1]); });
+    double d64 = ns_per_cycle([&](uint32_t c) { sink = q16_div(op[2 * c] >> 8, op[2 * c + 1]); });
+    printf("  PC: q16_mul32 %.2f ns (64 bits %.2f), q16_div32 %.2f ns (64 bits %.2f)\n", m32, m64, d32, d64);
+    return failed;
+  });
+
+  pc_scenario("décimas: P sin eco satura", []() {
+    int failed = 0;
+    Tenths p0 = {3}, q = {1};
+    KalmanFilter<Tenths, 1, 2> k(50 << 8, p0, q);
+    const uint16_t none[2] = {0, 0};
+    const Tenths r[2] = {{5}, {5}};
+    uint8_t lowest = 255;
+    // 100 s sin eco a 10 ms por ciclo: antes P volvía a 0 cada 256 ciclos
+    for (uint32_t c = 0; c < 10000; c++) {
+      k.predict();
+      k.update(none, r);
+      if (c >= 252 && k.p.v < lowest) lowest = k.p.v;
+    }
+    printf("  P x10 tras 10000 ciclos sin eco: %u (mínimo desde el ciclo 252: %u)\n", k.p.v, lowest);
+    PC_CHECK(k.p.v == 255 && lowest == 255, "P x10 volvió a %u", lowest);
+    const uint16_t echo[2] = {60 << 8, 60 << 8};
+    k.predict();
+    k.update(echo, r);
+    PC_CHECK(k.x > (59 << 8), "la primera lectura tras el hueco no manda: x = %u", k.x);
+    return failed;
+  });
+
+  printf(pcFailures ? "%d escenarios con fallos\n" : "todo correcto\n", pcFailures);
+  return pcFailures ? 1 : 0;
+}
@@ -0,0 +1,176 @@
+// ============================================================
+//  PRUEBA DEL PRE-FILTRO DE MEDIANA: LATENCIA DE ACTIVACIÓN
+//  Herramienta de PC (no es un sketch): filtrokalman5.cpp se compila dos
+//  veces con KALMAN_REPLAY, con NO_MEDIAN_PREFILTER y tal cual, y las dos
+//  reciben las mismas lecturas simuladas de un objeto (ruido 0.3 cm) con
+//  fallos sueltos por lectura: 10 % sin eco, 5 % con la marca de zona
+//  difusa (MAX_DIST + 1) y 5 % de multitrayecto (10-40 cm más corta). Como loop(), la variante con mediana pasa cada lectura
+//  disparada por median_prefilter() antes de process_cycle(). Por variante,
+//  sobre 40 episodios:
+//  - arranque: kalman_init() con el objeto ya delante a 90 cm, ms hasta
+//    activar
+//  - aparición: tras 8 s sin nada llega otro a 75 cm (el estado sigue en
+//    90), ms hasta activar
+//  - episodios sin activar (la mediana no debe perder ninguno)
+//  Y median_prefilter() sola: la primera lectura con eco (al arrancar o
+//  tras irse el objeto) pasa tal cual, no una mediana contra ceros.
+//  Sale con 1 si falla alguna comprobación.
+//
+//  Compilar: g++ -std=gnu++11 -O2 -o prueba_mediana prueba_mediana.cpp
+//            (con -DNO_INNOVATION_GATING: las dos sin compuerta)
+//  Uso:      ./prueba_mediana
+// ============================================================
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#define KALMAN_REPLAY
+#include "nucleo_pc.h"
+#include "kalman.h"
+
+// Las dos variantes del sketch en espacios de nombres distintos; la
+// primera sin mediana (la macro sigue definida hasta el #undef)
+#define NO_MEDIAN_PREFILTER
+namespace sin_mediana {
+#include "filtrokalman5.cpp"
+}
+#undef NO_MEDIAN_PREFILTER
+namespace con_mediana {
+#include "filtrokalman5.cpp"
+}
+
+#define EPISODES 40
+#define BOOT_CM 90.0f
+#define APPEAR_CM 75.0f
+#define SIGMA_CM 0.3f
+#define AWAY_MS 8000  // > LED_ON_DURATION + LED_OFF_DURATION: LED listo
+#define HOLD_MS 3000  // objeto delante, hasta activar
+
+#define SENSORS 2
+static_assert(sizeof(sin_mediana::SENSOR_PINS) / sizeof(sin_mediana::SENSOR_PINS[0]) == SENSORS,
+              "la prueba simula 2 sensores");
+
+// Lectura de un ciclo (Q8.8, 0 sin eco) con los fallos sueltos; cm <= 0:
+// sin objeto
+static uint16_t reading_q8(float cm, std::mt19937 &rng) {
+  using namespace sin_mediana;
+  std::uniform_real_distribution<float> u(0, 1);
+  std::normal_distribution<float> noise(0, SIGMA_CM);
+  if (cm <= 0) return 0;
+  float f = u(rng);
+  if (f < 0.10f) return 0;                // sin eco
+  if (f < 0.15f) return OUT_OF_RANGE_Q8;  // zona difusa
+  cm += noise(rng);
+  if (f < 0.20f) cm -= 10 + 30 * u(rng);  // multitrayecto
+  return (uint16_t)(cm * 256 + 0.5f);
+}
+
+// Una variante del sketch, vista desde la prueba
+struct Variant {
+  const char *name;
+  void (*init)();
+  void (*led)(unsigned long now);
+  void (*cycle)(const uint16_t *z, unsigned long now);
+  bool (*fired)(uint8_t i);
+  uint16_t (*prefilter)(uint8_t i, uint16_t z);  // lo que hace loop()
+  uint8_t *ledState;
+};
+
+static const Variant VARIANTS[] = {
+  {"sin mediana", sin_mediana::kalman_init, sin_mediana::update_led_cycle, sin_mediana::process_cycle,
+   [](uint8_t i) { return sin_mediana::sensors.fired(i); }, [](uint8_t, uint16_t z) { return z; },
+   &sin_mediana::currentLedState},
+  {"con mediana", con_mediana::kalman_init, con_mediana::update_led_cycle, con_mediana::process_cycle,
+   [](uint8_t i) { return con_mediana::sensors.fired(i); }, con_mediana::median_prefilter,
+   &con_mediana::currentLedState},
+};
+
+struct Outcome {
+  std::vector<long> bootMs, appearMs;  // latencias de los episodios activados
+  int misses;
+};
+
+// Ciclos de now en adelante con el objeto a cm (<= 0: sin objeto); devuelve
+// los ms desde el primero hasta activar, o -1 si no activa
+static long run(const Variant &k, unsigned long &now, unsigned long ms, float cm, std::mt19937 &rng) {
+  long fired = -1;
+  for (unsigned long t = 0; t < ms; t += sin_mediana::READ_INTERVAL, now += sin_mediana::READ_INTERVAL) {
+    k.led(now);
+    uint16_t z[SENSORS];
+    for (uint8_t i = 0; i < SENSORS; i++) {
+      uint16_t r = reading_q8(cm, rng);  // la misma secuencia en las dos
+      z[i] = k.fired(i) ? k.prefilter(i, r) : 0;
+    }
+    uint8_t before = *k.ledState;
+    k.cycle(z, now);
+    if (fired < 0 && before == LED_OFF && *k.ledState == LED_ON) fired = t;
+  }
+  return fired;
+}
+
+static Outcome replay(const Variant &k) {
+  Outcome o = {{}, {}, 0};
+  std::mt19937 rng(7);
+  unsigned long now = 0;
+  for (int e = 0; e < EPISODES; e++) {
+    // Arranque con el objeto delante y, tras un rato sin nada, aparición
+    k.init();
+    long boot = run(k, now, HOLD_MS, BOOT_CM, rng);
+    run(k, now, AWAY_MS, 0, rng);
+    long appear = run(k, now, HOLD_MS, APPEAR_CM, rng);
+    run(k, now, AWAY_MS, 0, rng);
+    if (boot < 0) o.misses++; else o.bootMs.push_back(boot);
+    if (appear < 0) o.misses++; else o.appearMs.push_back(appear);
+  }
+  return o;
+}
+
+static long mean(const std::vector<long> &v) {
+  long sum = 0;
+  for (long l : v) sum += l;
+  return v.empty() ? 0 : sum / (long)v.size();
+}
+
+static long worst(const std::vector<long> &v) { return v.empty() ? 0 : *std::max_element(v.begin(), v.end()); }
+
+int main() {
+  pc_scenario("20 % de lecturas fallidas", []() {
+    int failed = 0;
+    Outcome o[2];
+    for (int v = 0; v < 2; v++) {
+      o[v] = replay(VARIANTS[v]);
+      printf("  %-12s arranque: media %4ld ms, máxima %4ld ms; aparición: media %4ld ms, máxima %4ld ms; %d sin activar\n",
+             VARIANTS[v].name, mean(o[v].bootMs), worst(o[v].bootMs), mean(o[v].appearMs), worst(o[v].appearMs),
+             o[v].misses);
+    }
+    // Sin compuerta la variante sin mediana pierde episodios: solo se mide
+    PC_CHECK(o[1].misses == 0, "%d episodios sin activar con mediana", o[1].misses);
+    PC_CHECK(mean(o[1].appearMs) < mean(o[0].appearMs), "la mediana no adelanta la activación al aparecer (%ld frente a %ld ms)",
+             mean(o[1].appearMs), mean(o[0].appearMs));
+    // El anillo se llena con la primera lectura: al arrancar no hay dos
+    // medianas contra ceros que retrasen la activación
+    PC_CHECK(mean(o[1].bootMs) < mean(o[0].bootMs), "la mediana no adelanta la activación al arrancar (%ld frente a %ld ms)",
+             mean(o[1].bootMs), mean(o[0].bootMs));
+    return failed;
+  });
+
+  pc_scenario("primeras lecturas de median_prefilter()", []() {
+    using namespace con_mediana;
+    int failed = 0;
+    const uint16_t a = CM_Q8(90), b = CM_Q8(75);
+    kalman_init();
+    PC_CHECK(median_prefilter(0, 0) == 0, "sin eco al arrancar");
+    PC_CHECK(median_prefilter(0, OUT_OF_RANGE_Q8) == OUT_OF_RANGE_Q8, "la marca de zona difusa no pasa tal cual");
+    PC_CHECK(median_prefilter(0, a) == a, "el primer eco da %u, no %u", median_prefilter(0, a), a);
+    PC_CHECK(median_prefilter(0, a) == a, "el segundo eco no pasa");
+    PC_CHECK(median_prefilter(0, 0) == a, "un eco perdido suelto pasa como sin eco");
+    for (int i = 0; i < 3; i++) median_prefilter(0, 0);  // el objeto se va
+    PC_CHECK(median_prefilter(0, b) == b, "el primer eco tras irse el objeto no pasa tal cual");
+    return failed;
+  });
+
+  printf(pcFailures ? "%d escenarios con fallos\n" : "todo correcto\n", pcFailures);
+  return pcFailures ? 1 : 0;
+}
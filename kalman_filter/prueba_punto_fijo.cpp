@@ -0,0 +1,229 @@
+// ============================================================
+//  PRUEBA DEL FILTRO EN PUNTO FIJO DE filtrokalman5.cpp
+//  Herramienta de PC (no es un sketch): el update_kalman() de
+//  filtrokalman5.cpp (compilado con KALMAN_REPLAY) frente al update_kalman()
+//  en float de filtrokalman3.cpp, los dos tal cual, sobre lecturas
+//  simuladas de dos sensores (ruido 0.3 cm, 1 % sin eco) de un objeto que
+//  se para y se mueve entre 5 y 17 cm (dentro del alcance de los dos):
+//  - error cuadrático medio y máximo frente a la distancia real
+//  - las mismas lecturas truncadas a cm enteros (el camino uint8_t
+//    anterior a Q8.8): el error que se comía la cuantización
+//  - tiempo por actualización en el PC (no son ciclos del AVR)
+//  Y la conversión eco -> cm de echo_to_q8(): todas las duraciones de
+//  116 µs (2 cm) a ECHO_TIMEOUT con los 11 factores de la tabla frente a
+//  t·c(T)/20000 exacto, y su coste en el PC frente a dividir por 58.
+//  Y el motor solo: KalmanFilter<Q16> frente a KalmanFilter<float> (el de
+//  filtrokalman3.cpp) con las mismas lecturas y el mismo R durante millones
+//  de ciclos, y la mayor divergencia de x y de P.
+//  Sale con 1 si falla alguna comprobación.
+//
+//  Compilar: g++ -std=gnu++11 -O2 -o prueba_punto_fijo prueba_punto_fijo.cpp
+//            (con -DKALMAN_X10: el filtro en décimas con estado Q8.8)
+//  Uso:      ./prueba_punto_fijo
+// ============================================================
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#define KALMAN_REPLAY
+#include "nucleo_pc.h"
+#include "kalman.h"
+
+// — filtrokalman3.cpp en float, como lo compila el IDE de Arduino —
+// (prototipos generados; abs, min, max y constrain son macros)
+namespace fk3 {
+#define LED_BUILTIN 13
+#define abs(x) ((x) > 0 ? (x) : -(x))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define constrain(x, lo, hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+inline unsigned long millis() { return 0; }
+inline void delayMicroseconds(unsigned int) {}
+inline unsigned long pulseIn(uint8_t, uint8_t, unsigned long) { return 0; }
+float read_distance(int trigPin, int echoPin);
+float update_kalman(float z1, float z2);
+float calculate_history_variation();
+#include "filtrokalman3.cpp"
+#undef LED_BUILTIN
+#undef abs
+#undef min
+#undef max
+#undef constrain
+}
+
+#include "filtrokalman5.cpp"
+
+// — Lecturas simuladas: distancia real y z de cada sensor (0 sin eco) —
+struct Sample {
+  float truth;
+  float z[2];
+};
+
+static std::vector<Sample> make_trace(size_t cycles) {
+  std::vector<Sample> t(cycles);
+  std::mt19937 rng(7);
+  std::normal_distribution<float> noise(0, 0.3f);
+  std::uniform_real_distribution<float> u(0, 1);
+  float d = 11, target = 11;
+  for (size_t c = 0; c < cycles; c++) {
+    // Parado 2 s, luego se desplaza a 5 cm/s hasta otro punto de 5-17 cm
+    if (c % 400 == 0) target = 5 + 12 * u(rng);
+    if (c % 400 >= 200) d += (target > d ? 1 : -1) * fminf(0.05f, fabsf(target - d));
+    t[c].truth = d;
+    for (int i = 0; i < 2; i++) t[c].z[i] = (u(rng) < 0.01f) ? 0 : d + noise(rng);
+  }
+  return t;
+}
+
+struct Score {
+  double rms, worst, ns;
+};
+
+// Error frente a la distancia real (tras el primer segundo) y ns por
+// actualización; estimate(c) aplica el ciclo c y devuelve cm
+template <typename F>
+static Score score(const std::vector<Sample> &t, F estimate) {
+  Score s = {0, 0, 0};
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<float> est(t.size());
+  for (size_t c = 0; c < t.size(); c++) est[c] = estimate(t[c]);
+  auto t1 = std::chrono::steady_clock::now();
+  s.ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / t.size();
+  double sum = 0;
+  size_t n = 0;
+  for (size_t c = 100; c < t.size(); c++) {
+    double e = est[c] - t[c].truth;
+    sum += e * e;
+    s.worst = fmax(s.worst, fabs(e));
+    n++;
+  }
+  s.rms = sqrt(sum / n);
+  return s;
+}
+
+static void report(const char *name, const Score &s) {
+  printf("  %-34s error RMS %.3f cm, máximo %.3f cm, %6.1f ns/actualización\n", name, s.rms, s.worst, s.ns);
+}
+
+// Una lectura simulada en Q8.8 (como read_distance) o en cm enteros
+static uint16_t to_q8(float cm, bool wholeCm) {
+  if (cm <= 0) return 0;
+  return wholeCm ? CM_Q8((uint16_t)cm) : (uint16_t)(cm * 256 + 0.5f);
+}
+
+int main() {
+  #ifdef KALMAN_X10
+    const char *mode = "filtrokalman5 (décimas, estado Q8.8)";
+    const double slack = 2.0;   // K y P en décimas: ~1.6x el error del float
+  #else
+    const char *mode = "filtrokalman5 (Q16.16)";
+    const double slack = 1.25;
+  #endif
+  std::vector<Sample> trace = make_trace(200000);
+
+  pc_scenario("error frente a la distancia real", [&]() {
+    int failed = 0;
+    Score ref = score(trace, [](const Sample &s) {
+      return fk3::update_kalman(s.z[0] > 0 ? s.z[0] : -1, s.z[1] > 0 ? s.z[1] : -1);
+    });
+    report("filtrokalman3 (float)", ref);
+    kalman_init();  // lo que haría setup()
+    Score fine = score(trace, [](const Sample &s) {
+      uint16_t z[NUM_SENSORS] = {to_q8(s.z[0], false), to_q8(s.z[1], false)};
+      return update_kalman(z) / 256.0f;
+    });
+    report(mode, fine);
+    kalman_init();
+    Score coarse = score(trace, [](const Sample &s) {
+      uint16_t z[NUM_SENSORS] = {to_q8(s.z[0], true), to_q8(s.z[1], true)};
+      return update_kalman(z) / 256.0f;
+    });
+    report("  con lecturas en cm enteros", coarse);
+    PC_CHECK(fine.rms <= slack * ref.rms, "RMS %.3f cm frente a %.3f cm en float", fine.rms, ref.rms);
+    PC_CHECK(fine.rms < coarse.rms, "Q8.8 %.3f cm no mejora los cm enteros (%.3f cm)", fine.rms, coarse.rms);
+    return failed;
+  });
+
+  pc_scenario("conversión eco -> cm frente a t·c(T)/20000", []() {
+    int failed = 0;
+    for (int8_t t = SOUND_TEMP_MIN; t < SOUND_TEMP_MIN + SOUND_TEMP_COUNT * SOUND_TEMP_STEP; t += SOUND_TEMP_STEP) {
+      set_sound_temperature(t);
+      double c = 331.3 + 0.606 * t, worst = 0, worst58 = 0;
+      for (unsigned long us = 116; us <= ECHO_TIMEOUT; us++) {
+        double exact = us * c / 20000;
+        worst = fmax(worst, fabs(echo_to_q8(us) / 256.0 - exact));
+        worst58 = fmax(worst58, fabs(us / 58.0 - exact));
+      }
+      printf("  %3d °C: factor %u, error máximo %.4f cm (t/58: %.3f cm)\n", t, echoFactor, worst, worst58);
+      // Q8.8 trunca (1/256 cm) y el factor redondea (0.5/factor relativo)
+      PC_CHECK(worst <= 1 / 256.0 + 0.5 / echoFactor * ECHO_TIMEOUT * c / 20000, "%d °C: %.4f cm", t, worst);
+      // En el AVR duration * echoFactor es de 32 bits
+      PC_CHECK((uint64_t)ECHO_TIMEOUT * echoFactor < (1ULL << 32), "%d °C: desborda 32 bits", t);
+    }
+    // Coste en el PC (no son ciclos del AVR): uint32_t como en el UNO
+    set_sound_temperature(AMBIENT_TEMP);
+    volatile uint32_t sink = 0, divisor = 58;  // volatile: división de verdad
+    const int rounds = 200;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+      for (uint32_t us = 116; us <= ECHO_TIMEOUT; us++) sink += (uint32_t)(us * echoFactor) >> ECHO_FACTOR_SHIFT;
+    auto t1 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+      for (uint32_t us = 116; us <= ECHO_TIMEOUT; us++) sink += (us << 8) / divisor;
+    auto t2 = std::chrono::steady_clock::now();
+    double n = rounds * (ECHO_TIMEOUT - 115.0);
+    printf("  PC: %.2f ns multiplicación+desplazamiento, %.2f ns división por 58\n",
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / n,
+           std::chrono::duration<double, std::nano>(t2 - t1).count() / n);
+    return failed;
+  });
+
+  pc_scenario("KalmanFilter<Q16> frente a float, 4 millones de ciclos", []() {
+    int failed = 0;
+    // Un objeto que deriva por todo el alcance, lecturas con ruido 0.5 cm,
+    // un 5 % sin eco (y rachas largas sin eco) y R que salta en 0.1-2.0 cm²
+    std::mt19937 rng(12);
+    std::normal_distribution<float> noise(0, 0.5f);
+    std::uniform_real_distribution<float> u(0, 1);
+    KalmanFilter<float, 1, 2> ref(10, 1, 0.01f);
+    Q16 p0 = {Q16_ONE}, q0 = {Q16_ONE / 100};
+    KalmanFilter<Q16, 1, 2> fixed(10 * Q16_ONE, p0, q0);
+    float d = 50, r[2] = {0.5f, 0.5f};
+    double worstX = 0, worstP = 0, worstPrel = 0;
+    uint32_t silent = 0;
+    for (uint32_t c = 0; c < 4000000; c++) {
+      d += 0.2f * (u(rng) - 0.5f);
+      if (d < MIN_DIST || d > MAX_DIST) d = 50;
+      if (!silent && u(rng) < 0.0005f) silent = 1 + (uint32_t)(500 * u(rng));  // hasta 5 s
+      float z[2];
+      int32_t zq[2];
+      Q16 rq[2];
+      for (int i = 0; i < 2; i++) {
+        if (u(rng) < 0.001f) r[i] = 0.1f * (1 + (int)(20 * u(rng)));
+        z[i] = (silent || u(rng) < 0.05f) ? 0 : d + noise(rng);
+        zq[i] = (int32_t)(z[i] * Q16_ONE);
+        z[i] = zq[i] / (float)Q16_ONE;  // la misma lectura en los dos
+        rq[i].v = (int32_t)(r[i] * Q16_ONE + 0.5f);
+        r[i] = rq[i].v / (float)Q16_ONE;
+      }
+      if (silent) silent--;
+      ref.predict();
+      ref.update(z, r);
+      fixed.predict();
+      fixed.update(zq, rq);
+      if (fixed.p.v > KALMAN_P_MAX * Q16_ONE) fixed.p.v = KALMAN_P_MAX * Q16_ONE;  // como el sketch
+      if (ref.p > KALMAN_P_MAX) ref.p = KALMAN_P_MAX;
+      worstX = fmax(worstX, fabs(fixed.x / 65536.0 - ref.x));
+      worstP = fmax(worstP, fabs(fixed.p.v / 65536.0 - ref.p));
+      worstPrel = fmax(worstPrel, fabs(fixed.p.v / 65536.0 - ref.p) / ref.p);
+    }
+    printf("  divergencia máxima: x %.4f cm, P %.5f cm² (%.3f %% relativo)\n", worstX, worstP, 100 * worstPrel);
+    PC_CHECK(worstX <= 0.05 && worstPrel <= 0.01, "Q16.16 se separa del float");
+    return failed;
+  });
+
+  printf(pcFailures ? "%d escenarios con fallos\n" : "todo correcto\n", pcFailures);
+  return pcFailures ? 1 : 0;
+}
@@ -0,0 +1,186 @@
+// ============================================================
+//  PRUEBA DE LA ESTIMACIÓN DE RUIDO CON UN SENSOR DEGRADADO
+//  Herramienta de PC (no es un sketch): filtrokalman5.cpp con KALMAN_REPLAY,
+//  sin NOISE_ESTIMATION (la regla ±1 común a todos los sensores) y con
+//  ella (R por sensor y q estimados), en el filtro 1D y en KALMAN_CV. Las
+//  cuatro variantes reciben las mismas lecturas de un objeto quieto a
+//  90 cm (ruido 0.3 cm): a los 3 s el sensor 2 se degrada a 4 cm durante
+//  2 s y luego se recupera. Por variante:
+//  - error cuadrático medio de la estimación con el sensor degradado
+//  - ciclos sin seguimiento (estabilidad o incertidumbre) durante la avería
+//  - tiempo hasta volver a seguir al objeto tras la recuperación
+//  - R x10 de cada sensor al final de la avería
+//  En KALMAN_CV la estimación no se aplica (R fija, como sin ella): las dos
+//  variantes CV deben dar lo mismo.
+//  Y en el 1D, con sensores de 1 cm: R x10 antes de un salto del objeto
+//  (re-adquisición) y su mínimo tras él, tras 1 s sin eco y al arrancar;
+//  con P al tope la muestra e² - P no debe hundir R hasta el suelo.
+//  Sale con 1 si falla alguna comprobación.
+//
+//  Compilar: g++ -std=gnu++11 -O2 -o prueba_ruido prueba_ruido.cpp
+//  Uso:      ./prueba_ruido
+// ============================================================
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#define KALMAN_REPLAY
+#include "nucleo_pc.h"
+#include "kalman.h"
+
+// Cuatro variantes del sketch en espacios de nombres distintos. Las macros
+// de cada inclusión siguen definidas en las siguientes: primero las que
+// no estiman el ruido, y KALMAN_CV se quita entre medias.
+#define NO_NOISE_ESTIMATION
+namespace regla {
+#include "filtrokalman5.cpp"
+}
+#define KALMAN_CV
+namespace regla_cv {
+#include "filtrokalman5.cpp"
+}
+#undef KALMAN_CV
+#undef NO_NOISE_ESTIMATION
+namespace estimador {
+#include "filtrokalman5.cpp"
+}
+#define KALMAN_CV
+namespace estimador_cv {
+#include "filtrokalman5.cpp"
+}
+
+#define OBJECT_CM 90.0f
+#define FAULT_START_MS 3000
+#define FAULT_END_MS 5000
+#define END_MS 8000
+#define SIGMA_CM 0.3f
+#define FAULT_SIGMA_CM 4.0f
+#define JUMP_MS 4000       // el objeto salta de OBJECT_CM a JUMP_CM
+#define JUMP_CM 60.0f
+#define AWAY_MS 6000       // y desaparece 1 s (P crece hasta el tope)
+#define BACK_MS 7000
+#define JUMP_SIGMA_CM 1.0f // R ≈ 1 cm², lejos del suelo de 0.1
+#define JUMP_MIN_R_X10 3    // R x10 mínima aceptable tras cada salto de P
+
+// Una variante del sketch, vista desde la prueba
+struct Variant {
+  const char *name;
+  void (*init)();
+  void (*cycle)(const uint16_t *z, unsigned long now);
+  uint16_t (*position)();
+  bool *locked;
+  Tenths *r;            // R x10 de cada sensor (kalman_r)
+};
+
+#define SENSORS 2
+static_assert(sizeof(regla::SENSOR_PINS) / sizeof(regla::SENSOR_PINS[0]) == SENSORS, "la prueba simula 2 sensores");
+
+#define VARIANT(label, ns) \
+  { label, ns::kalman_init, ns::process_cycle, ns::kalman_position, &ns::trackingLocked, ns::kalman_r }
+
+static const Variant VARIANTS[] = {
+  VARIANT("1D, regla ±1", regla),
+  VARIANT("1D, estimación", estimador),
+  VARIANT("CV, regla ±1", regla_cv),
+  VARIANT("CV, estimación", estimador_cv),
+};
+
+struct Outcome {
+  double rms;              // cm, con el sensor degradado
+  unsigned blocked;        // ciclos sin seguimiento durante la avería
+  long recoveryMs;         // tras la avería hasta volver a seguir (-1: nunca)
+  uint8_t r[SENSORS];      // R x10 al final de la avería
+};
+
+// Lecturas Q8.8 de los dos sensores en cada ciclo (las mismas para todos)
+static std::vector<uint16_t> make_readings() {
+  std::vector<uint16_t> z;
+  std::mt19937 rng(13);
+  std::normal_distribution<float> noise(0, 1);
+  for (unsigned long now = 0; now < END_MS; now += regla::READ_INTERVAL) {
+    bool fault = now >= FAULT_START_MS && now < FAULT_END_MS;
+    for (uint8_t i = 0; i < SENSORS; i++) {
+      float sigma = (fault && i == 1) ? FAULT_SIGMA_CM : SIGMA_CM;
+      z.push_back((uint16_t)((OBJECT_CM + sigma * noise(rng)) * 256 + 0.5f));
+    }
+  }
+  return z;
+}
+
+static Outcome run(const Variant &k, const std::vector<uint16_t> &z) {
+  Outcome o = {0, 0, -1, {0, 0}};
+  k.init();
+  double sum = 0;
+  unsigned n = 0;
+  for (size_t c = 0; c < z.size() / SENSORS; c++) {
+    unsigned long now = c * regla::READ_INTERVAL;
+    k.cycle(&z[SENSORS * c], now);
+    if (now >= FAULT_START_MS && now < FAULT_END_MS) {
+      double e = k.position() / 256.0 - OBJECT_CM;
+      sum += e * e;
+      n++;
+      if (!*k.locked) o.blocked++;
+      if (now + regla::READ_INTERVAL >= FAULT_END_MS)
+        for (uint8_t i = 0; i < SENSORS; i++) o.r[i] = k.r[i].v;
+    }
+    if (now >= FAULT_END_MS && o.recoveryMs < 0 && *k.locked) o.recoveryMs = now - FAULT_END_MS;
+  }
+  o.rms = sqrt(sum / n);
+  return o;
+}
+
+int main() {
+  const std::vector<uint16_t> z = make_readings();
+  Outcome o[4];
+  pc_scenario("sensor 2 degradado a 4 cm durante 2 s", [&]() {
+    int failed = 0;
+    for (int v = 0; v < 4; v++) {
+      o[v] = run(VARIANTS[v], z);
+      printf("  %-16s error RMS %.2f cm, %3u/%u ciclos sin seguimiento, vuelve en %ld ms, R x10 %u/%u\n",
+             VARIANTS[v].name, o[v].rms, o[v].blocked, (FAULT_END_MS - FAULT_START_MS) / regla::READ_INTERVAL,
+             o[v].recoveryMs, o[v].r[0], o[v].r[1]);
+    }
+    PC_CHECK(o[1].rms < o[0].rms, "1D: el error no baja (%.2f frente a %.2f cm)", o[1].rms, o[0].rms);
+    PC_CHECK(o[1].blocked <= o[0].blocked, "1D: más ciclos sin seguimiento (%u frente a %u)", o[1].blocked, o[0].blocked);
+    PC_CHECK(o[1].recoveryMs >= 0 && o[1].recoveryMs <= 500, "1D: tarda %ld ms en volver", o[1].recoveryMs);
+    PC_CHECK(o[1].r[1] > o[1].r[0], "1D: R no distingue el sensor degradado");
+    PC_CHECK(o[3].rms == o[2].rms && o[3].blocked == o[2].blocked && o[3].recoveryMs == o[2].recoveryMs,
+             "CV: la estimación cambia el resultado (%u frente a %u ciclos sin seguimiento)", o[3].blocked, o[2].blocked);
+    return failed;
+  });
+
+  pc_scenario("re-adquisición con sensores de 1 cm (1D)", []() {
+    int failed = 0;
+    std::mt19937 rng(17);
+    std::normal_distribution<float> noise(0, 1);
+    estimador::kalman_init();
+    const unsigned long settle = 10 * regla::READ_INTERVAL;
+    uint8_t boot = 255, before = 0, after = 255, back = 255;
+    for (unsigned long now = 0; now < END_MS; now += regla::READ_INTERVAL) {
+      float cm = (now < JUMP_MS) ? OBJECT_CM : JUMP_CM;
+      bool away = now >= AWAY_MS && now < BACK_MS;
+      uint16_t z[SENSORS];
+      for (uint8_t i = 0; i < SENSORS; i++)
+        z[i] = away ? 0 : (uint16_t)((cm + JUMP_SIGMA_CM * noise(rng)) * 256 + 0.5f);
+      estimador::process_cycle(z, now);
+      uint8_t r = std::min(estimador::kalman_r[0].v, estimador::kalman_r[1].v);
+      if (now < settle) boot = std::min(boot, r);
+      if (now + regla::READ_INTERVAL == JUMP_MS) before = r;
+      if (now >= JUMP_MS && now < JUMP_MS + settle) after = std::min(after, r);
+      if (now >= BACK_MS && now < BACK_MS + settle) back = std::min(back, r);
+    }
+    printf("  R x10 antes del salto %u; mínima tras él %u, tras 1 s sin eco %u, al arrancar %u\n", before, after, back,
+           boot);
+    // R real 1 cm² (10 en décimas); la estimación oscila entre ~5 y ~11 con
+    // el olvido de 1/32, y el suelo es 1
+    PC_CHECK(after >= JUMP_MIN_R_X10, "R cae de %u a %u al re-adquirir", before, after);
+    PC_CHECK(back >= JUMP_MIN_R_X10, "R cae de %u a %u al volver el objeto", before, back);
+    PC_CHECK(boot >= JUMP_MIN_R_X10, "R cae a %u al arrancar", boot);
+    return failed;
+  });
+
+  printf(pcFailures ? "%d escenarios con fallos\n" : "todo correcto\n", pcFailures);
+  return pcFailures ? 1 : 0;
+}
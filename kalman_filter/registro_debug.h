@@ -0,0 +1,119 @@
+// ============================================================
+//  LECTURA DE CAPTURAS DEBUG (herramientas de PC)
+//  Líneas de ciclo de filtrokalman3/4/5.cpp: "z1:.. z2:..[!] K:.. P:.. V:.."
+//  con o sin espacios tras ':', y de carrito*.cpp: "z1: .., z2: .., estimate: ..".
+//  Las demás líneas (SENSOR, DIFUSA, CRUCE, LED OFF, ...) no son de ciclo.
+//  Lo usan suavizador_rts.cpp, afinador.cpp y repeticion_bayes.cpp.
+//  Solo POSIX: la captura se mapea en memoria y se recorre una vez.
+// ============================================================
+
+#ifndef REGISTRO_DEBUG_H
+#define REGISTRO_DEBUG_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DEBUG_MAX_SENSORS 8
+
+// — Un ciclo registrado —
+struct DebugCycle {
+  float z[DEBUG_MAX_SENSORS];         // cm, 0 sin eco
+  bool rejected[DEBUG_MAX_SENSORS];   // '!': descartada por la compuerta de innovación
+  uint8_t sensors;                    // campos zN presentes (N máximo)
+  float k;                            // estimación registrada (K: o estimate:)
+};
+
+// Número decimal con signo opcional ("90.17", "90", "-3.5"); avanza p
+inline bool debug_parse_number(const char *&p, const char *end, float &out) {
+  while (p < end && *p == ' ') p++;
+  bool neg = false;
+  if (p < end && *p == '-') { neg = true; p++; }
+  if (p >= end || *p < '0' || *p > '9') return false;
+  // Dígitos como entero y una sola división: "16.85" da el float más
+  // cercano, el mismo que el sketch (sumar 0.1f por decimal se desvía un ulp
+  // y cambia el bin de BayesGrid en las réplicas)
+  long long digits = 0;
+  double scale = 1;
+  while (p < end && *p >= '0' && *p <= '9') digits = digits * 10 + (*p++ - '0');
+  if (p < end && *p == '.') {
+    p++;
+    while (p < end && *p >= '0' && *p <= '9') {
+      if (scale < 1e15) { digits = digits * 10 + (*p - '0'); scale *= 10; }
+      p++;
+    }
+  }
+  float value = (float)(digits / scale);
+  out = neg ? -value : value;
+  return true;
+}
+
+// Campos de la línea [p, end); false si no es una línea de ciclo (sin K: ni estimate:)
+inline bool debug_parse_cycle(const char *p, const char *end, DebugCycle &c) {
+  bool haveK = false;
+  memset(&c, 0, sizeof(c));
+  while (p < end) {
+    if (*p == 'z' && p + 2 < end && p[1] >= '1' && p[1] <= '9' && p[2] == ':') {
+      uint8_t i = p[1] - '1';
+      p += 3;
+      float z;
+      if (!debug_parse_number(p, end, z) || i >= DEBUG_MAX_SENSORS) continue;
+      c.z[i] = z;
+      c.rejected[i] = (p < end && *p == '!');
+      if (i >= c.sensors) c.sensors = i + 1;
+    } else if (*p == 'K' && p + 1 < end && p[1] == ':') {
+      p += 2;
+      haveK = debug_parse_number(p, end, c.k);
+    } else if (*p == 'e' && end - p >= 9 && memcmp(p, "estimate:", 9) == 0) {
+      p += 9;
+      haveK = debug_parse_number(p, end, c.k);
+    } else if (*p == '-' && p + 1 < end && p[1] == '>') {
+      break;  // estado de activación: fin de los campos
+    } else {
+      p++;
+    }
+  }
+  return haveK;
+}
+
+// — Captura mapeada en memoria (lectura secuencial) —
+struct MappedFile {
+  const char *data = 0;
+  size_t size = 0;
+
+  bool open(const char *path) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) { ::close(fd); return false; }
+    void *m = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // el mapeo sigue válido sin el descriptor
+    if (m == MAP_FAILED) return false;
+    madvise(m, st.st_size, MADV_SEQUENTIAL);
+    data = (const char *)m;
+    size = st.st_size;
+    return true;
+  }
+
+  ~MappedFile() {
+    if (data) munmap((void *)data, size);
+  }
+
+  // Llama a f(linea, fin) para cada línea, sin copiarla
+  template <typename F>
+  void for_each_line(F f) const {
+    const char *p = data, *end = data + size;
+    while (p < end) {
+      const char *eol = (const char *)memchr(p, '\n', end - p);
+      if (!eol) eol = end;
+      f(p, eol);
+      p = eol + 1;
+    }
+  }
+};
+
+#endif
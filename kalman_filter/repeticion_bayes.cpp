@@ -0,0 +1,131 @@
+// ============================================================
+//  RÉPLICA MASIVA DE CAPTURAS DE carrito.cpp / carrito2.cpp
+//  Herramienta de PC (no es un sketch): pasa capturas serie
+//  "z1: .., z2: .., estimate: .." (semanas de registros de campo) por la
+//  misma lógica del sketch (adaptive_noise, update_belief con predicción y
+//  expected_value) con BayesHostGrid de bayes_host.h: pasada AVX2 si la CPU
+//  la tiene, genérica si no. Cada captura empieza con la creencia
+//  uniforme, como el sketch al arrancar.
+//  Primero se leen todas las capturas (mmap, POSIX) y después se replican:
+//  el resumen da por separado la lectura y la réplica (fotogramas/s).
+//
+//  Compilar: g++ -std=gnu++11 -O3 -o repeticion_bayes repeticion_bayes.cpp
+//            (sin -march=native: el backend se elige al arrancar)
+//  Uso:      ./repeticion_bayes [-s carrito|carrito2] [-b generico|avx2] [-csv] captura.log...
+//            -s    sketch que generó las capturas (carrito)
+//            -b    fuerza un backend (por defecto el mejor de la CPU)
+//            -csv  escribe por ciclo captura,ciclo,z1,z2,estimacion,registrada
+//  El resumen (stderr) da también la mayor diferencia entre la estimación
+//  replicada y la registrada: el sketch la imprime con 2 decimales.
+// ============================================================
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "bayes_host.h"
+#include "registro_debug.h"
+
+const uint8_t MOTION_RADIUS = 4;  // el de carrito.cpp y carrito2.cpp
+
+// Un ciclo leído: lecturas del sketch (-1 sin eco) y su estimación
+struct Frame {
+  float z1, z2;
+  float logged;
+};
+
+struct Capture {
+  const char *path;
+  std::vector<Frame> frames;
+};
+
+// Réplica de todas las capturas con la lógica del sketch Sketch; devuelve
+// los segundos de réplica (sin E/S)
+template <typename Sketch>
+static double replay(Sketch &sketch, const std::vector<Capture> &captures, bool csv, double &worst) {
+  std::vector<float> estimates;
+  double seconds = 0;
+  worst = 0;
+  for (size_t f = 0; f < captures.size(); f++) {
+    const std::vector<Frame> &frames = captures[f].frames;
+    estimates.resize(frames.size());
+    sketch.init();
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < frames.size(); c++) estimates[c] = sketch.cycle(frames[c].z1, frames[c].z2);
+    auto t1 = std::chrono::steady_clock::now();
+    seconds += std::chrono::duration<double>(t1 - t0).count();
+    for (size_t c = 0; c < frames.size(); c++) {
+      worst = fmax(worst, fabs(estimates[c] - frames[c].logged));
+      if (csv) {
+        printf("%zu,%zu,%.2f,%.2f,%.2f,%.2f\n", f, c, frames[c].z1, frames[c].z2, estimates[c], frames[c].logged);
+      }
+    }
+  }
+  return seconds;
+}
+
+int main(int argc, char **argv) {
+  const char *sketchName = "carrito";
+  bool csv = false;
+  std::vector<Capture> captures;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+      sketchName = argv[++i];
+    } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+      setenv("BAYES_HOST_BACKEND", argv[++i], 1);
+      if (!bayes_host_find(argv[i])) { fprintf(stderr, "backend %s no disponible\n", argv[i]); return 1; }
+    } else if (!strcmp(argv[i], "-csv")) {
+      csv = true;
+    } else {
+      Capture c = {argv[i], {}};
+      captures.push_back(c);
+    }
+  }
+  if (captures.empty()) {
+    fprintf(stderr, "uso: %s [-s carrito|carrito2] [-b generico|avx2] [-csv] captura.log...\n", argv[0]);
+    return 1;
+  }
+
+  // — Lectura: una línea de ciclo por fotograma —
+  size_t frames = 0, bytes = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (Capture &c : captures) {
+    MappedFile log;
+    if (!log.open(c.path)) { perror(c.path); return 1; }
+    bytes += log.size;
+    c.frames.reserve(log.size / 30);  // ~30 bytes por línea de ciclo
+    log.for_each_line([&](const char *line, const char *eol) {
+      DebugCycle d;
+      if (!debug_parse_cycle(line, eol, d) || d.sensors < 2) return;
+      Frame f = {d.z[0], d.z[1], d.k};
+      c.frames.push_back(f);
+    });
+    frames += c.frames.size();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  if (frames == 0) { fprintf(stderr, "sin ciclos (z1: .., z2: .., estimate: ..)\n"); return 1; }
+  if (csv) fputs("captura,ciclo,z1,z2,estimacion,registrada\n", stdout);
+
+  // — Réplica con las constantes del sketch —
+  double seconds, worst;
+  const char *backend = bayes_host_backend().name;
+  if (!strcmp(sketchName, "carrito")) {
+    static BayesHostCarrito<BayesHostGrid<281, 2, true>, MOTION_RADIUS> sketch(2, 30, 0.1f);
+    seconds = replay(sketch, captures, csv, worst);
+  } else if (!strcmp(sketchName, "carrito2")) {
+    static BayesHostCarrito<BayesHostGrid<131, 2>, MOTION_RADIUS> sketch(2, 15, 0.1f);
+    seconds = replay(sketch, captures, csv, worst);
+  } else {
+    fprintf(stderr, "sketch desconocido: %s\n", sketchName);
+    return 1;
+  }
+  double reading = std::chrono::duration<double>(t1 - t0).count();
+  fprintf(stderr, "%zu capturas, %zu ciclos (%.1f h a 10 ms)\n", captures.size(), frames, frames / 360000.0);
+  fprintf(stderr, "  lectura %.2f s (%.0f MB/s), réplica %.2f s (%.2f M fotogramas/s, %s)\n", reading,
+          bytes / reading / 1e6, seconds, frames / seconds / 1e6, backend);
+  fprintf(stderr, "  estimación replicada vs registrada: máx %.3f cm\n", worst);
+  return 0;
+}
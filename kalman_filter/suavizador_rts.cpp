@@ -0,0 +1,199 @@
+// ============================================================
+//  SUAVIZADOR RTS PARA REGISTROS DEBUG DE filtrokalman4/5.cpp
+//  Herramienta de PC (no es un sketch): lee la salida serie
+//  "z1:.. z2:.. K:.. P:.. V:.." de una captura, corre hacia adelante el
+//  Kalman de velocidad constante de kalman.h y hacia atrás el suavizador
+//  Rauch–Tung–Striebel, y escribe por ciclo la distancia suavizada: la
+//  mejor estimación a posteriori de la distancia "verdadera".
+//  La entrada se mapea en memoria (mmap, POSIX) y se analiza en streaming,
+//  así que capturas de varios GB van a velocidad de disco. El paso hacia
+//  atrás necesita el estado filtrado de cada ciclo (24 bytes, ~0.6 veces la
+//  captura): va a un fichero temporal (tmpfile(), en /tmp) mapeado en
+//  memoria, no al heap, así que el sistema lo pagina a disco y la memoria
+//  propia no crece con la captura; /tmp necesita ese espacio libre.
+//
+//  Compilar: g++ -std=gnu++11 -O2 -o suavizador_rts suavizador_rts.cpp
+//  Uso:      ./suavizador_rts captura.log [-dt s] [-r cm²] [-a cm/s²] > suave.csv
+//            -dt  periodo de cada línea (READ_INTERVAL, 0.01 s)
+//            -r   ruido de medición de cada sensor (0.5 cm²)
+//            -a   σ de la aceleración del objeto (CV_ACCEL_NOISE, 200 cm/s²)
+//  Salida CSV: ciclo,x_cm,v_cm_s,sigma_cm,k_registro_cm
+//  Las lecturas 0 (sin eco) y las marcadas '!' (rechazadas) no se usan.
+// ============================================================
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "kalman.h"
+#include "registro_debug.h"
+
+// Estado filtrado (luego suavizado) de un ciclo y la estimación registrada
+struct Sample {
+  float x, v;
+  float p00, p01, p11;
+  float k_log;
+};
+
+// — Estados filtrados en un fichero temporal, mapeado para el paso atrás —
+struct SampleSpill {
+  FILE *file = 0;
+  Sample chunk[4096];
+  size_t pending = 0, count = 0;
+  Sample *data = 0;
+
+  bool open() { return (file = tmpfile()) != 0; }
+
+  bool push(const Sample &s) {
+    chunk[pending++] = s;
+    count++;
+    if (pending < sizeof(chunk) / sizeof(chunk[0])) return true;
+    return flush();
+  }
+
+  bool flush() {
+    bool ok = fwrite(chunk, sizeof(Sample), pending, file) == pending;
+    pending = 0;
+    return ok;
+  }
+
+  // Tras el último push: todos los ciclos, de lectura y escritura
+  bool map() {
+    if (!flush() || fflush(file) != 0) return false;
+    void *m = mmap(0, count * sizeof(Sample), PROT_READ | PROT_WRITE, MAP_SHARED, fileno(file), 0);
+    if (m == MAP_FAILED) return false;
+    data = (Sample *)m;
+    return true;
+  }
+
+  ~SampleSpill() {
+    if (data) munmap(data, count * sizeof(Sample));
+    if (file) fclose(file);  // tmpfile() lo borra al cerrarlo
+  }
+};
+
+// — Escritura con búfer propio y formato de punto fijo (sin printf por campo) —
+static char outBuf[1 << 20];
+static size_t outLen = 0;
+
+static void flush_out() {
+  fwrite(outBuf, 1, outLen, stdout);
+  outLen = 0;
+}
+
+static void put_char(char ch) { outBuf[outLen++] = ch; }
+
+static void put_uint(unsigned long long v) {
+  char tmp[24];
+  int n = 0;
+  do { tmp[n++] = '0' + v % 10; v /= 10; } while (v);
+  while (n) put_char(tmp[--n]);
+}
+
+// scale = 10^decimales
+static void put_fixed(double v, unsigned scale) {
+  if (v < 0) { put_char('-'); v = -v; }
+  unsigned long long q = (unsigned long long)(v * scale + 0.5);
+  put_uint(q / scale);
+  put_char('.');
+  unsigned long long frac = q % scale;
+  for (int d = scale / 10; d > 0; d /= 10) { put_char('0' + frac / d); frac %= d; }
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "uso: %s captura.log [-dt s] [-r cm2] [-a cm/s2] > suave.csv\n", argv[0]);
+    return 1;
+  }
+  float dt = 0.01f, r = 0.5f, accel = 200.0f;
+  for (int i = 2; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-dt")) dt = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "-r")) r = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "-a")) accel = atof(argv[i + 1]);
+  }
+
+  // — Entrada mapeada en memoria, lectura secuencial —
+  MappedFile log;
+  if (!log.open(argv[1])) { perror(argv[1]); return 1; }
+
+  // — Ruido de proceso de aceleración blanca (igual que CV_Q00/01/11) —
+  float a2 = accel * accel;
+  float q00 = a2 * dt * dt * dt * dt / 4, q01 = a2 * dt * dt * dt / 2, q11 = a2 * dt * dt;
+
+  // — Paso hacia adelante: Kalman CV de kalman.h, una muestra por línea —
+  // P inicial grande: la primera lectura fija la posición
+  KalmanFilter<float, 2, 1> kf(0, 1e4f, 1e4f, dt, q00, q01, q11);
+  static SampleSpill spill;  // estática: el búfer de 96 KB fuera de la pila
+  if (!spill.open()) { perror("tmpfile"); return 1; }
+  unsigned long long readings = 0;
+  bool spilled = true;
+  size_t firstReading = 0;  // ciclos previos: sin dato, fuera del resumen
+  log.for_each_line([&](const char *line, const char *eol) {
+    DebugCycle c;
+    if (!debug_parse_cycle(line, eol, c)) return;
+    kf.predict();
+    for (uint8_t i = 0; i < c.sensors; i++) {
+      if (c.z[i] <= 0 || c.rejected[i]) continue;
+      kf.update_one(c.z[i], r);
+      if (readings++ == 0) firstReading = spill.count;
+    }
+    Sample s = {kf.x, kf.v, kf.p00, kf.p01, kf.p11, c.k};
+    spilled = spill.push(s) && spilled;
+  });
+  size_t n = spill.count;
+  if (readings == 0) { fprintf(stderr, "sin lecturas (z1:.. K:..)\n"); return 1; }
+  if (!spilled || !spill.map()) { perror("fichero temporal"); return 1; }
+  Sample *samples = spill.data;
+
+  // — Paso hacia atrás RTS: x_s(k) = x_f(k) + C·(x_s(k+1) - F·x_f(k)) —
+  // C = P_f·Fᵀ·P_p⁻¹ con P_p = F·P_f·Fᵀ + Q; se sobrescribe cada muestra
+  double xs = samples[n - 1].x, vs = samples[n - 1].v;
+  double s00 = samples[n - 1].p00, s01 = samples[n - 1].p01, s11 = samples[n - 1].p11;
+  for (size_t k = n - 1; k-- > 0;) {
+    Sample &f = samples[k];
+    double xp = f.x + dt * f.v, vp = f.v;
+    double pp00 = f.p00 + dt * (2 * f.p01 + dt * f.p11) + q00;
+    double pp01 = f.p01 + dt * f.p11 + q01;
+    double pp11 = f.p11 + q11;
+    double det = pp00 * pp11 - pp01 * pp01;
+    // P_f·Fᵀ
+    double a00 = f.p00 + dt * f.p01, a01 = f.p01;
+    double a10 = f.p01 + dt * f.p11, a11 = f.p11;
+    double c00 = (a00 * pp11 - a01 * pp01) / det, c01 = (a01 * pp00 - a00 * pp01) / det;
+    double c10 = (a10 * pp11 - a11 * pp01) / det, c11 = (a11 * pp00 - a10 * pp01) / det;
+    double dx = xs - xp, dv = vs - vp;
+    xs = f.x + c00 * dx + c01 * dv;
+    vs = f.v + c10 * dx + c11 * dv;
+    // P_s = P_f + C·(P_s(k+1) - P_p)·Cᵀ
+    double d00 = s00 - pp00, d01 = s01 - pp01, d11 = s11 - pp11;
+    double e00 = c00 * d00 + c01 * d01, e01 = c00 * d01 + c01 * d11;
+    double e10 = c10 * d00 + c11 * d01, e11 = c10 * d01 + c11 * d11;
+    s00 = f.p00 + e00 * c00 + e01 * c01;
+    s01 = f.p01 + e00 * c10 + e01 * c11;
+    s11 = f.p11 + e10 * c10 + e11 * c11;
+    f.x = xs; f.v = vs;
+    f.p00 = s00; f.p01 = s01; f.p11 = s11;
+  }
+
+  // — Salida CSV y resumen (diferencia entre K registrado y suavizado) —
+  double sq = 0, worst = 0;
+  fputs("ciclo,x_cm,v_cm_s,sigma_cm,k_registro_cm\n", stdout);
+  for (size_t k = 0; k < n; k++) {
+    const Sample &s = samples[k];
+    put_uint(k);                          put_char(',');
+    put_fixed(s.x, 100);               put_char(',');
+    put_fixed(s.v, 10);                put_char(',');
+    put_fixed(sqrt(s.p00 > 0 ? s.p00 : 0), 1000); put_char(',');
+    put_fixed(s.k_log, 100);           put_char('\n');
+    if (outLen > sizeof(outBuf) - 128) flush_out();
+    if (k < firstReading) continue;
+    double e = s.k_log - s.x;
+    sq += e * e;
+    if (fabs(e) > worst) worst = fabs(e);
+  }
+  flush_out();
+  fprintf(stderr, "%zu ciclos, %llu lecturas; K registrado vs suavizado: rms %.3f cm, max %.3f cm\n",
+          n, readings, sqrt(sq / (n - firstReading)), worst);
+  return 0;
+}